@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../task_executor.hpp"
+#include "bench_util.hpp"
+
+/**
+ * Task Executor
+ * Runs the same jobs through the shared TaskExecutor and by spawning one
+ * std::thread per piece, as the shard mount and index builds did before:
+ * many small parallelFor calls (job overhead), then jobs that nest a
+ * parallelFor inside each piece (a sort inside a mount task). Each piece
+ * sums a short range so the cost is mostly scheduling.
+ */
+static uint64_t work(size_t begin, size_t end) {
+    uint64_t sum = 0;
+    for (size_t i = begin; i < end; ++i) sum += i * 2654435761u;
+    return sum;
+}
+
+template <typename Fn>
+static void spawnFor(size_t n, size_t chunks, Fn fn) {
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < chunks; ++c) threads.emplace_back(fn, n * c / chunks, n * (c + 1) / chunks);
+    for (auto& t : threads) t.join();
+}
+
+int main() {
+    const size_t jobs = 2000;
+    const size_t items = 8192;
+    const size_t chunks = 4;
+    std::atomic<uint64_t> sink{0};
+    auto piece = [&](size_t begin, size_t end) { sink += work(begin, end); };
+
+    TaskExecutor executor(chunks);
+    double pooled = bench::bestOf(3, [&] {
+        for (size_t j = 0; j < jobs; ++j) executor.parallelFor(items, chunks, piece);
+    });
+    double spawned = bench::bestOf(3, [&] {
+        for (size_t j = 0; j < jobs; ++j) spawnFor(items, chunks, piece);
+    });
+    std::printf("%zu jobs of %zu pieces\n", jobs, chunks);
+    std::printf("  executor      %8.1f ms  %7.1f us/job\n", pooled * 1e3, pooled * 1e6 / jobs);
+    std::printf("  std::thread   %8.1f ms  %7.1f us/job\n", spawned * 1e3, spawned * 1e6 / jobs);
+
+    const size_t outer = 200;
+    auto nested = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) executor.parallelFor(items, chunks, piece);
+    };
+    auto nestedSpawn = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) spawnFor(items, chunks, piece);
+    };
+    double pooledNested = bench::bestOf(3, [&] { executor.parallelFor(outer, chunks, nested); });
+    double spawnedNested = bench::bestOf(3, [&] { spawnFor(outer, chunks, nestedSpawn); });
+    std::printf("%zu outer pieces, each running one inner job of %zu pieces\n", outer, chunks);
+    std::printf("  executor      %8.1f ms\n", pooledNested * 1e3);
+    std::printf("  std::thread   %8.1f ms\n", spawnedNested * 1e3);
+
+    TaskExecutor::Stats stats = executor.stats();
+    std::printf("executor ran %llu tasks, %llu stolen\n", static_cast<unsigned long long>(stats.executed),
+                static_cast<unsigned long long>(stats.steals));
+    return 0;
+}
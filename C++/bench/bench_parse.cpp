@@ -0,0 +1,43 @@
+#define TASK_MANAGER_NO_MAIN
+#include "../task_manager_cli.cpp"
+#include "bench_util.hpp"
+
+/**
+ * Task File Parsing
+ * Generates a tasks document of about 8 MB in the saved layout and reports
+ * GB/s for the structural index alone, for parseDocument (index, section
+ * scan and RecordBuilder on the executor) and for json::parse. Also checks
+ * that parseDocument returns the same document as json::parse, including
+ * for a record nested deeper than RecordBuilder recurses.
+ */
+int main() {
+    TaskExecutor executor(4);
+    string content = bench::document(13000).dump(4);
+    double gigabytes = content.size() / 1e9;
+    printf("%.1f MB, %zu threads, %s classifier\n", content.size() / 1e6, executor.threadCount(), structural_index::path());
+
+    size_t structurals = 0;
+    double index = bench::bestOf(5, [&] { structurals = structural_index::build(content)->size(); });
+    json built, expected;
+    double document = bench::bestOf(5, [&] { built = parseDocument(content, executor); });
+    double plain = bench::bestOf(5, [&] { expected = json::parse(content); });
+    if (built != expected) {
+        fprintf(stderr, "parseDocument and json::parse disagree\n");
+        return 1;
+    }
+    printf("%-22s %8.2f GB/s  %7.1f ms  (%zu structurals)\n", "structural_index", gigabytes / index, index * 1e3, structurals);
+    printf("%-22s %8.2f GB/s  %7.1f ms\n", "parseDocument", gigabytes / document, document * 1e3);
+    printf("%-22s %8.2f GB/s  %7.1f ms\n", "json::parse", gigabytes / plain, plain * 1e3);
+
+    // A record nested far past RecordBuilder's depth limit goes to json::parse
+    json deep = json::parse(content);
+    string nested = string(2000, '[') + "1" + string(2000, ']');
+    deep["open_tasks"][0]["notes"] = json::parse(nested);
+    string deepContent = deep.dump(4);
+    if (parseDocument(deepContent, executor) != json::parse(deepContent)) {
+        fprintf(stderr, "deeply nested record parsed differently\n");
+        return 1;
+    }
+    printf("record nested 2000 deep: same document as json::parse\n");
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include "../json.hpp"
+#include "../console_buffer.hpp"
+#include "bench_util.hpp"
+
+/**
+ * List Rendering
+ * Renders 1M completed-task rows in pages of 20, once the way the list views
+ * did before (cout << json fields) and once through ConsoleBuffer with one
+ * write per page. Run with stdout sent to /dev/null; timings go to stderr.
+ */
+using json = nlohmann::json;
+
+int main() {
+    const size_t rows = 1000000;
+    const size_t page = 20;
+    json tasks = json::array();
+    for (size_t i = 0; i < 1000; ++i) tasks.push_back(bench::completedTask(i));
+
+    double streamed = bench::bestOf(3, [&] {
+        for (size_t row = 0; row < rows; ++row) {
+            const json& task = tasks[row % tasks.size()];
+            std::cout << row + 1 << ". " << task["name"] << " - Priority: " << task["priority"]
+                      << " - Completed: " << task["completed_at"] << "\n";
+            if ((row + 1) % page == 0) std::cout.flush();
+        }
+        std::cout.flush();
+    });
+
+    ConsoleBuffer console;
+    double buffered = bench::bestOf(3, [&] {
+        for (size_t row = 0; row < rows; ++row) {
+            const json& task = tasks[row % tasks.size()];
+            console << row + 1 << ". ";
+            console.quoted(task["name"].get_ref<const std::string&>());
+            console << " - Priority: ";
+            console.quoted(task["priority"].get_ref<const std::string&>());
+            console << " - Completed: ";
+            console.quoted(task["completed_at"].get_ref<const std::string&>());
+            console << '\n';
+            if ((row + 1) % page == 0) console.flush();
+        }
+        console.flush();
+    });
+
+    std::fprintf(stderr, "%zu rows, %zu per page\n", rows, page);
+    std::fprintf(stderr, "cout << json   %8.1f ms  %6.0f ns/row\n", streamed * 1e3, streamed * 1e9 / rows);
+    std::fprintf(stderr, "ConsoleBuffer  %8.1f ms  %6.0f ns/row\n", buffered * 1e3, buffered * 1e9 / rows);
+    return 0;
+}
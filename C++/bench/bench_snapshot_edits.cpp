@@ -0,0 +1,44 @@
+#define TASK_MANAGER_NO_MAIN
+#include "../task_manager_cli.cpp"
+#include "bench_util.hpp"
+
+/**
+ * Snapshot Edits
+ * For open task lists of 1k-1M records, times one edit as the writer makes it
+ * (copy the snapshot, replace a record in the middle of the list, append
+ * one) followed by the diff that recordEdit and the patch log take of it,
+ * next to a plain copy of the section as one JSON array, which is what every
+ * edit cost when sections were copied whole. Checks the diff finds exactly
+ * the two changes.
+ */
+int main() {
+    printf("%10s %16s %16s\n", "records", "edit+diff (us)", "json copy (us)");
+    for (size_t n : {size_t(1000), size_t(10000), size_t(100000), size_t(1000000)}) {
+        json tasks = json::array();
+        for (size_t i = 0; i < n; ++i) tasks.push_back(bench::openTask(i));
+        TaskSnapshot current;
+        current.sections["open_tasks"] = TaskSnapshot::Section::of(json(tasks));
+
+        const int edits = 200;
+        size_t changes = 0;
+        double edit = bench::bestOf(5, [&] {
+            for (int e = 0; e < edits; ++e) {
+                TaskSnapshot next = current;
+                RecordList& open_tasks = next.sections.at("open_tasks").records;
+                json task = open_tasks[n / 2];
+                task["priority"] = "high";
+                open_tasks.set(n / 2, make_shared<const json>(move(task)));
+                open_tasks.push_back(make_shared<const json>(bench::openTask(n + e)));
+                changes = diffRecords("open_tasks", current.records("open_tasks"), next.records("open_tasks")).size();
+            }
+        });
+        if (changes != 2) {
+            fprintf(stderr, "diff found %zu changes instead of 2\n", changes);
+            return 1;
+        }
+        json copy;
+        double copied = bench::bestOf(5, [&] { copy = tasks; });
+        printf("%10zu %16.2f %16.1f\n", n, edit * 1e6 / edits, copied * 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#define TASK_MANAGER_NO_MAIN
+#include "../task_manager_cli.cpp"
+#include "bench_util.hpp"
+
+/**
+ * Snapshot Reader Scaling
+ * Reader threads read the open task count from the current snapshot in a
+ * loop while one writer adds a task every millisecond; prints total reads
+ * per second for 1-8 readers. Readers never wait for the writer, so the
+ * total should grow with the reader count up to the number of cores.
+ */
+int main() {
+    bench::enterScratchDir("task_manager_bench_readers");
+    TaskManager app(false, 1);
+    for (size_t i = 0; i < 1000; ++i) {
+        json task = bench::openTask(i);
+        app.addTaskRecord(task["name"], task["priority"], task["deadline"]);
+    }
+
+    const double seconds = 1.0;
+    printf("%8s %14s %12s %10s\n", "readers", "reads/s", "per reader", "writes");
+    for (size_t readers : {1, 2, 4, 8}) {
+        atomic<bool> running{true};
+        atomic<uint64_t> reads{0};
+        vector<thread> threads;
+        for (size_t r = 0; r < readers; ++r) {
+            threads.emplace_back([&] {
+                uint64_t local = 0;
+                size_t sink = 0;
+                while (running.load(memory_order_relaxed)) {
+                    sink += app.openTaskCount();
+                    local++;
+                }
+                reads += local + (sink == 0);
+            });
+        }
+        size_t writes = 0;
+        auto start = bench::Clock::now();
+        while (bench::secondsSince(start) < seconds) {
+            json task = bench::openTask(1000 + writes++);
+            app.addTaskRecord(task["name"], task["priority"], task["deadline"]);
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        running = false;
+        for (auto& t : threads) t.join();
+        double elapsed = bench::secondsSince(start);
+        printf("%8zu %14.0f %12.0f %10zu\n", readers, reads / elapsed, reads / elapsed / readers, writes);
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../parallel_sort.hpp"
+#include "bench_util.hpp"
+
+/**
+ * Parallel Sort
+ * Sorts random 64-bit list keys (sort key above row, as sortedRows builds
+ * them) with std::sort and with parallel_sort::sort on executors of 1-8
+ * threads, at sizes on both sides of MIN_PARALLEL. Times are the best of
+ * five runs, each on a fresh copy of the same input.
+ */
+int main() {
+    std::mt19937_64 random(42);
+    std::printf("%10s %12s", "keys", "std::sort");
+    const size_t threadCounts[] = {1, 2, 4, 8};
+    for (size_t threads : threadCounts) std::printf(" %9zu thr", threads);
+    std::printf("   (ms)\n");
+
+    for (size_t n : {size_t(1000), size_t(10000), parallel_sort::MIN_PARALLEL, size_t(1000000), size_t(10000000)}) {
+        std::vector<uint64_t> input(n);
+        for (size_t i = 0; i < n; ++i) input[i] = (random() & 0xffffffff00000000ull) | i;
+        std::vector<uint64_t> expected = input;
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<uint64_t> keys;
+        double plain = 1e300;
+        for (int r = 0; r < 5; ++r) {
+            keys = input;
+            auto start = bench::Clock::now();
+            std::sort(keys.begin(), keys.end());
+            plain = std::min(plain, bench::secondsSince(start));
+        }
+        std::printf("%10zu %12.3f", n, plain * 1e3);
+
+        for (size_t threads : threadCounts) {
+            TaskExecutor executor(threads);
+            double best = 1e300;
+            for (int r = 0; r < 5; ++r) {
+                keys = input;
+                auto start = bench::Clock::now();
+                parallel_sort::sort(keys, executor);
+                best = std::min(best, bench::secondsSince(start));
+            }
+            if (keys != expected) {
+                std::fprintf(stderr, "parallel_sort::sort gave a different order at n=%zu\n", n);
+                return 1;
+            }
+            std::printf(" %13.3f", best * 1e3);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
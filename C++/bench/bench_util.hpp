@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include "../json.hpp"
+
+/**
+ * Bench Utilities
+ * Timing, a scratch working directory and generated task records for the
+ * standalone benchmarks. Benchmarks that drive TaskManager run from
+ * <scratch>/bin, so its ../data directory is a fresh one under the system
+ * temp directory.
+ */
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Best of repeats runs of fn, in seconds
+ */
+template <typename Fn>
+double bestOf(int repeats, Fn fn) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = Clock::now();
+        fn();
+        double elapsed = secondsSince(start);
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+/**
+ * Empty the scratch tree and make <scratch>/bin the working directory
+ */
+inline void enterScratchDir(const std::string& name) {
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / name;
+    fs::remove_all(root);
+    fs::create_directories(root / "bin");
+    fs::current_path(root / "bin");
+    std::printf("scratch data in %s\n", (root / "data").string().c_str());
+}
+
+/**
+ * Deadline i in the app's DD-MM-YYYY form, spread over 2025-2027 so some
+ * tasks are overdue, some due soon and most in the future
+ */
+inline std::string deadline(size_t i) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "%02zu-%02zu-%04zu", 1 + i % 28, 1 + i / 28 % 12, 2025 + i / 336 % 3);
+    return text;
+}
+
+inline const char* priority(size_t i) {
+    return i % 3 == 0 ? "high" : i % 3 == 1 ? "medium" : "low";
+}
+
+/**
+ * Open task i as addTaskRecord writes it; every tenth name needs escaping
+ * or UTF-8 handling
+ */
+inline nlohmann::json openTask(size_t i) {
+    std::string name = i % 10 == 0 ? "R\u00e9viser le \"rapport\" " : "Write the quarterly report ";
+    return {
+        {"name", name + std::to_string(i)},
+        {"priority", priority(i)},
+        {"deadline", deadline(i)},
+        {"created_at", "2026-10-01T09:30:00"}
+    };
+}
+
+/**
+ * Completed task i as completeTask writes it
+ */
+inline nlohmann::json completedTask(size_t i) {
+    nlohmann::json task = openTask(i);
+    task["completed_at"] = "2026-10-02T17:45:12";
+    task["status"] = "completed";
+    return task;
+}
+
+/**
+ * Exit signature i as addExitSignature writes it
+ */
+inline nlohmann::json historyEntry(size_t i) {
+    char timestamp[24];
+    std::snprintf(timestamp, sizeof(timestamp), "2026-10-%02zuT%02zu:%02zu:00", 1 + i / 1440 % 28, i / 60 % 24, i % 60);
+    return {{"program", "Task Manager"}, {"language", "(CPP-CLI Version)"}, {"timestamp", timestamp}};
+}
+
+/**
+ * Tasks document with records open tasks, completed tasks and history entries
+ */
+inline nlohmann::json document(size_t records) {
+    nlohmann::json data = {
+        {"metadata", {{"author", "bench"}, {"language", "(CPP-CLI Version)"}, {"last_modified", "2026-10-18T10:00:00"}}},
+        {"open_tasks", nlohmann::json::array()},
+        {"completed_tasks", nlohmann::json::array()},
+        {"activity_history", nlohmann::json::array()}
+    };
+    for (size_t i = 0; i < records; ++i) {
+        data["open_tasks"].push_back(openTask(i));
+        data["completed_tasks"].push_back(completedTask(i));
+        data["activity_history"].push_back(historyEntry(i));
+    }
+    return data;
+}
+
+} // namespace bench
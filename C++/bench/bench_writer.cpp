@@ -0,0 +1,45 @@
+#define TASK_MANAGER_NO_MAIN
+#include "../task_manager_cli.cpp"
+#include "bench_util.hpp"
+
+/**
+ * Task File Writing
+ * Writes a generated snapshot of 100k open tasks, 100k completed tasks and
+ * 100k history entries with writeSnapshot (plain and collecting record
+ * checksums, as saveTasks does) and with `stream << setw(4) << data`, the
+ * way the file was written before, and checks all produce the same bytes.
+ */
+int main() {
+    const size_t records = 100000;
+    json data = bench::document(records);
+    TaskSnapshot snapshot;
+    for (auto& [key, value] : data.items()) snapshot.sections[key] = TaskSnapshot::Section::of(json(value));
+
+    string written, checked, streamed;
+    json checksums;
+    double plain = bench::bestOf(5, [&] {
+        written.clear();
+        writeSnapshot(written, snapshot);
+    });
+    double withChecksums = bench::bestOf(5, [&] {
+        checked.clear();
+        checksums = json();
+        writeSnapshot(checked, snapshot, &checksums);
+    });
+    double stream = bench::bestOf(5, [&] {
+        ostringstream out;
+        out << setw(4) << data;
+        streamed = out.str();
+    });
+    if (written != streamed || checked != streamed) {
+        fprintf(stderr, "writeSnapshot output differs from setw(4) <<\n");
+        return 1;
+    }
+
+    double megabytes = streamed.size() / 1e6;
+    printf("%.1f MB, identical bytes\n", megabytes);
+    printf("%-28s %7.1f ms  %6.0f MB/s\n", "writeSnapshot", plain * 1e3, megabytes / plain);
+    printf("%-28s %7.1f ms  %6.0f MB/s\n", "writeSnapshot + checksums", withChecksums * 1e3, megabytes / withChecksums);
+    printf("%-28s %7.1f ms  %6.0f MB/s\n", "ostringstream << setw(4)", stream * 1e3, megabytes / stream);
+    return 0;
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "crc32c.hpp"
+
+/**
+ * Block Compression
+ * Self-contained LZ4-style compressor and a block container for archive and
+ * shard files. Records are grouped into blocks of about BLOCK_SIZE bytes and
+ * each block is compressed on its own, so a reader can decompress just the
+ * blocks it needs (e.g. only the newest ones when paging backwards).
+ *
+ * Container layout (little endian):
+ *   "TMB2"
+ *   per block: u32 raw size, u32 stored size, u8 method (0 raw, 1 lz),
+ *              u32 CRC32C of the stored payload, payload
+ *   footer:    u64 offset per block, u32 block count, "TMBI"
+ */
+namespace block_compression {
+
+constexpr size_t BLOCK_SIZE = 64 * 1024;
+constexpr char MAGIC[4] = {'T', 'M', 'B', '2'};
+constexpr char FOOTER_MAGIC[4] = {'T', 'M', 'B', 'I'};
+
+namespace detail {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LAST_LITERALS = 5;
+constexpr unsigned HASH_BITS = 12;
+
+inline uint32_t load32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline void putLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+template <typename T>
+void putLE(std::string& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+template <typename T>
+T getLE(const char* p) {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<T>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return value;
+}
+
+inline void corrupt() {
+    throw std::runtime_error("Corrupt compressed block");
+}
+
+} // namespace detail
+
+/**
+ * Compress src into LZ4-style sequences (token, literals, offset, match length)
+ */
+inline std::string compress(std::string_view src) {
+    using namespace detail;
+    std::string out;
+    out.reserve(src.size() / 2 + 16);
+    const char* base = src.data();
+    const size_t n = src.size();
+
+    std::vector<int32_t> table(size_t(1) << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+
+    auto emit = [&](size_t literal_end, size_t match_length, size_t offset) {
+        size_t literals = literal_end - anchor;
+        size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+        uint8_t token = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4 | (match_code < 15 ? match_code : 15));
+        out.push_back(static_cast<char>(token));
+        if (literals >= 15) putLength(out, literals - 15);
+        out.append(base + anchor, literals);
+        if (match_length) {
+            putLE<uint16_t>(out, static_cast<uint16_t>(offset));
+            if (match_code >= 15) putLength(out, match_code - 15);
+        }
+    };
+
+    while (n >= MIN_MATCH + LAST_LITERALS && i + MIN_MATCH + LAST_LITERALS <= n) {
+        uint32_t sequence = load32(base + i);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        int32_t candidate = table[hash];
+        table[hash] = static_cast<int32_t>(i);
+
+        if (candidate >= 0 && i - candidate <= 0xffff && load32(base + candidate) == sequence) {
+            size_t length = MIN_MATCH;
+            size_t limit = n - LAST_LITERALS;
+            while (i + length < limit && base[candidate + length] == base[i + length]) length++;
+            emit(i, length, i - candidate);
+            i += length;
+            anchor = i;
+        }
+        else {
+            i++;
+        }
+    }
+    emit(n, 0, 0);
+    return out;
+}
+
+/**
+ * Decompress a block produced by compress(); raw_size is the expected output size
+ */
+inline std::string decompress(std::string_view src, size_t raw_size) {
+    using namespace detail;
+    std::string out;
+    out.reserve(raw_size);
+    const char* p = src.data();
+    const char* end = p + src.size();
+
+    auto readLength = [&](size_t length) {
+        if (length != 15) return length;
+        unsigned char byte;
+        do {
+            if (p >= end) corrupt();
+            byte = static_cast<unsigned char>(*p++);
+            length += byte;
+        } while (byte == 255);
+        return length;
+    };
+
+    while (p < end) {
+        uint8_t token = static_cast<uint8_t>(*p++);
+        size_t literals = readLength(token >> 4);
+        if (static_cast<size_t>(end - p) < literals || out.size() + literals > raw_size) corrupt();
+        out.append(p, literals);
+        p += literals;
+        if (p == end) break;
+
+        if (end - p < 2) corrupt();
+        size_t offset = getLE<uint16_t>(p);
+        p += 2;
+        size_t length = readLength(token & 0x0f) + MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + length > raw_size) corrupt();
+        size_t from = out.size() - offset;
+        for (size_t k = 0; k < length; ++k) out.push_back(out[from + k]);
+    }
+    if (out.size() != raw_size) corrupt();
+    return out;
+}
+
+/**
+ * Builds a container from newline-separated records, cutting a block whenever
+ * the pending bytes reach BLOCK_SIZE (records never straddle blocks)
+ */
+class BlockWriter {
+private:
+    std::string output = std::string(MAGIC, sizeof(MAGIC));
+    std::string pending;
+    std::vector<uint64_t> offsets;
+
+    void flushBlock() {
+        if (pending.empty()) return;
+        offsets.push_back(output.size());
+        std::string packed = compress(pending);
+        bool useRaw = packed.size() >= pending.size();
+        const std::string& payload = useRaw ? pending : packed;
+        detail::putLE<uint32_t>(output, static_cast<uint32_t>(pending.size()));
+        detail::putLE<uint32_t>(output, static_cast<uint32_t>(payload.size()));
+        output.push_back(useRaw ? 0 : 1);
+        detail::putLE<uint32_t>(output, Crc32c::compute(payload.data(), payload.size()));
+        output += payload;
+        pending.clear();
+    }
+
+public:
+    void add(std::string_view record) {
+        if (!pending.empty() && pending.size() + record.size() + 1 > BLOCK_SIZE) flushBlock();
+        pending.append(record);
+        pending.push_back('\n');
+    }
+
+    /**
+     * Close the last block, append the footer and return the container bytes
+     */
+    std::string finish() {
+        flushBlock();
+        for (uint64_t offset : offsets) detail::putLE<uint64_t>(output, offset);
+        detail::putLE<uint32_t>(output, static_cast<uint32_t>(offsets.size()));
+        output.append(FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+        return std::move(output);
+    }
+};
+
+/**
+ * Random access to the blocks of a container; decompresses on demand
+ */
+class BlockReader {
+private:
+    std::string data;
+    std::vector<uint64_t> offsets;
+
+public:
+    /**
+     * True if bytes start with the container magic
+     */
+    static bool isContainer(std::string_view bytes) {
+        return bytes.size() >= sizeof(MAGIC) && std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    explicit BlockReader(std::string bytes) : data(std::move(bytes)) {
+        const size_t tail = sizeof(uint32_t) + sizeof(FOOTER_MAGIC);
+        if (!isContainer(data) || data.size() < sizeof(MAGIC) + tail ||
+            std::memcmp(data.data() + data.size() - sizeof(FOOTER_MAGIC), FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) {
+            throw std::runtime_error("Not a block container");
+        }
+        uint32_t count = detail::getLE<uint32_t>(data.data() + data.size() - tail);
+        if (static_cast<uint64_t>(count) * 8 > data.size() - sizeof(MAGIC) - tail) detail::corrupt();
+        const char* index = data.data() + data.size() - tail - static_cast<size_t>(count) * 8;
+        for (uint32_t i = 0; i < count; ++i) offsets.push_back(detail::getLE<uint64_t>(index + 8 * i));
+    }
+
+    static std::string readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open " + path);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    size_t blockCount() const { return offsets.size(); }
+
+    /**
+     * Decompressed bytes of block i (newline-separated records); the payload
+     * checksum is verified before anything is decoded
+     */
+    std::string block(size_t i) const {
+        const size_t header = 13;
+        uint64_t offset = offsets.at(i);
+        if (offset + header > data.size()) detail::corrupt();
+        const char* p = data.data() + offset;
+        uint32_t raw_size = detail::getLE<uint32_t>(p);
+        uint32_t stored_size = detail::getLE<uint32_t>(p + 4);
+        char method = p[8];
+        if (offset + header + stored_size > data.size()) detail::corrupt();
+        std::string_view payload(p + header, stored_size);
+        if (Crc32c::compute(payload.data(), payload.size()) != detail::getLE<uint32_t>(p + 9)) {
+            throw std::runtime_error("Checksum mismatch in block " + std::to_string(i));
+        }
+        if (method == 0) {
+            if (stored_size != raw_size) detail::corrupt();
+            return std::string(payload);
+        }
+        return decompress(payload, raw_size);
+    }
+};
+
+} // namespace block_compression
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * Console Buffer
+ * Rows of a page are formatted into one reusable buffer (integers through
+ * std::to_chars, strings quoted and escaped the way the JSON printer does) and
+ * handed to the terminal with a single write per page, instead of pushing
+ * every field through iostream formatting.
+ */
+class ConsoleBuffer {
+private:
+    std::string buffer;
+
+    static void writeAll(const char* data, size_t size) {
+#ifdef _WIN32
+        std::fwrite(data, 1, size, stdout);
+        std::fflush(stdout);
+#else
+        while (size > 0) {
+            ssize_t written = ::write(STDOUT_FILENO, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+#endif
+    }
+
+public:
+    /**
+     * Unties cin from cout for a scope, so reads do not flush cout; output
+     * made inside the scope must go through flush() before prompting
+     */
+    class Untied {
+    private:
+        std::ostream* previous;
+
+    public:
+        Untied() : previous(std::cin.tie(nullptr)) {}
+        ~Untied() { std::cin.tie(previous); }
+        Untied(const Untied&) = delete;
+        Untied& operator=(const Untied&) = delete;
+    };
+
+    ConsoleBuffer() { buffer.reserve(64 * 1024); }
+
+    ConsoleBuffer& operator<<(std::string_view text) {
+        buffer.append(text);
+        return *this;
+    }
+
+    ConsoleBuffer& operator<<(char c) {
+        buffer.push_back(c);
+        return *this;
+    }
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char>>>
+    ConsoleBuffer& operator<<(T number) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        buffer.append(digits, result.ptr);
+        return *this;
+    }
+
+    /**
+     * Append text as a JSON string literal, byte-for-byte what the JSON
+     * printer emits for valid UTF-8 (only quotes, backslashes and control
+     * characters are escaped)
+     */
+    ConsoleBuffer& quoted(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        buffer.push_back('"');
+        size_t run = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            buffer.append(text.data() + run, i - run);
+            run = i + 1;
+            buffer.push_back('\\');
+            switch (c) {
+                case '"': buffer.push_back('"'); break;
+                case '\\': buffer.push_back('\\'); break;
+                case '\b': buffer.push_back('b'); break;
+                case '\f': buffer.push_back('f'); break;
+                case '\n': buffer.push_back('n'); break;
+                case '\r': buffer.push_back('r'); break;
+                case '\t': buffer.push_back('t'); break;
+                default:
+                    buffer.append("u00");
+                    buffer.push_back(hex[c >> 4]);
+                    buffer.push_back(hex[c & 0x0f]);
+            }
+        }
+        buffer.append(text.data() + run, text.size() - run);
+        buffer.push_back('"');
+        return *this;
+    }
+
+    /**
+     * Write the buffered text after anything still pending in cout/stdout,
+     * then reuse the buffer (its capacity is kept)
+     */
+    void flush() {
+        if (buffer.empty()) return;
+        std::cout.flush();
+        std::fflush(stdout);
+        writeAll(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "task_date.hpp"
+
+/**
+ * Daily Rollup
+ * Per-day counters in a dense array indexed by day number (from the first
+ * counted day), with running prefix sums beside it, so the total over any
+ * date range is two lookups. Updates mostly land on today, the end of the
+ * array, where refreshing the prefix sums touches only a few entries.
+ * Only days within DENSE_DAYS_BEFORE / DENSE_DAYS_AFTER of the reference day
+ * go in the array; a stray timestamp far from it (year 0001 or 9999) is kept
+ * in a sparse map instead of stretching the array over millions of days.
+ */
+class DailyRollup {
+public:
+    static constexpr int32_t DENSE_DAYS_BEFORE = 10 * 366;
+    static constexpr int32_t DENSE_DAYS_AFTER = 366;
+
+private:
+    int32_t windowBegin;             // days [windowBegin, windowEnd) may be dense
+    int32_t windowEnd;
+    int32_t firstDay = 0;
+    std::vector<int32_t> counts;     // counts[i] belongs to day firstDay + i
+    std::vector<int64_t> prefix{0};  // prefix[i] = counts[0] + ... + counts[i - 1]
+    std::map<int32_t, int64_t> outliers;
+
+    void rebuildPrefix() {
+        prefix.assign(counts.size() + 1, 0);
+        for (size_t i = 0; i < counts.size(); ++i) prefix[i + 1] = prefix[i] + counts[i];
+    }
+
+    /**
+     * Position of day in counts, growing the array to cover it
+     */
+    size_t slot(int32_t day) {
+        if (counts.empty()) {
+            firstDay = day;
+            counts.push_back(0);
+            prefix.push_back(0);
+        }
+        else if (day < firstDay) {
+            counts.insert(counts.begin(), static_cast<size_t>(firstDay - day), 0);
+            firstDay = day;
+            rebuildPrefix();
+        }
+        else if (static_cast<size_t>(day - firstDay) >= counts.size()) {
+            size_t size = static_cast<size_t>(day - firstDay) + 1;
+            counts.resize(size, 0);
+            prefix.resize(size + 1, prefix.back());
+        }
+        return static_cast<size_t>(day - firstDay);
+    }
+
+    /**
+     * Sum of all dense days before day
+     */
+    int64_t before(int32_t day) const {
+        if (counts.empty() || day <= firstDay) return 0;
+        size_t end = static_cast<size_t>(day - firstDay);
+        return prefix[end < counts.size() ? end : counts.size()];
+    }
+
+public:
+    /**
+     * Empty rollup whose dense window is centred on reference (usually today)
+     */
+    explicit DailyRollup(TaskDate reference)
+        : windowBegin(reference.dayNumber() - DENSE_DAYS_BEFORE), windowEnd(reference.dayNumber() + DENSE_DAYS_AFTER + 1) {}
+
+    void add(TaskDate day, int32_t delta) {
+        int32_t n = day.dayNumber();
+        if (n < windowBegin || n >= windowEnd) {
+            if ((outliers[n] += delta) == 0) outliers.erase(n);
+            return;
+        }
+        size_t i = slot(n);
+        counts[i] += delta;
+        for (size_t j = i + 1; j < prefix.size(); ++j) prefix[j] += delta;
+    }
+
+    /**
+     * Total over the days in [from, to)
+     */
+    int64_t between(TaskDate from, TaskDate to) const {
+        if (!(from < to)) return 0;
+        int64_t total = before(to.dayNumber()) - before(from.dayNumber());
+        for (auto it = outliers.lower_bound(from.dayNumber()); it != outliers.end() && it->first < to.dayNumber(); ++it) {
+            total += it->second;
+        }
+        return total;
+    }
+
+    int64_t on(TaskDate day) const { return between(day, day + 1); }
+
+    bool empty() const { return counts.empty(); }
+    TaskDate first() const { return TaskDate::fromDayNumber(firstDay); }
+    const std::vector<int32_t>& dense() const { return counts; }
+    const std::map<int32_t, int64_t>& sparse() const { return outliers; }
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "task_executor.hpp"
+
+/**
+ * Parallel Sort
+ * Merge sort for large vectors of plain keys on the shared TaskExecutor:
+ * contiguous chunks are sorted concurrently, then merged pairwise in rounds.
+ * Every round is split by output position (co-ranking the two runs) so all
+ * threads stay busy even when only one pair is left. Small inputs fall back
+ * to std::sort.
+ */
+namespace parallel_sort {
+
+constexpr size_t MIN_PARALLEL = size_t(1) << 15;
+
+namespace detail {
+
+/**
+ * Elements of a that come first among the first k of a stable merge of a and b
+ */
+template <typename T>
+size_t coRank(size_t k, const T* a, size_t m, const T* b, size_t n) {
+    size_t lo = k > n ? k - n : 0;
+    size_t hi = std::min(k, m);
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+        if (j > 0 && i < m && !(b[j - 1] < a[i])) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+} // namespace detail
+
+/**
+ * Sort values ascending using the executor's threads
+ */
+template <typename T>
+void sort(std::vector<T>& values, TaskExecutor& executor) {
+    const size_t threads = executor.threadCount();
+    const size_t n = values.size();
+    if (n < MIN_PARALLEL || threads < 2) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    size_t runs = 1;
+    while (runs * 2 <= threads) runs *= 2;
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t r = 0; r <= runs; ++r) bounds[r] = n * r / runs;
+    executor.parallelFor(runs, runs, [&](size_t first, size_t last) {
+        for (size_t r = first; r < last; ++r) std::sort(values.begin() + bounds[r], values.begin() + bounds[r + 1]);
+    });
+
+    // Merge rounds: each output slice of a pair's merge is one piece of work
+    std::vector<T> buffer(n);
+    T* from = values.data();
+    T* to = buffer.data();
+    for (size_t width = 1; width < runs; width *= 2) {
+        executor.parallelFor(n, threads, [&](size_t begin, size_t end) {
+            for (size_t r = 0; r < runs; r += 2 * width) {
+                size_t lo = bounds[r], mid = bounds[r + width], hi = bounds[std::min(r + 2 * width, runs)];
+                size_t k0 = std::max(begin, lo), k1 = std::min(end, hi);
+                if (k0 >= k1) continue;
+                const T* a = from + lo;
+                const T* b = from + mid;
+                size_t m = mid - lo, len = hi - mid;
+                size_t i0 = detail::coRank(k0 - lo, a, m, b, len);
+                size_t i1 = detail::coRank(k1 - lo, a, m, b, len);
+                std::merge(a + i0, a + i1, b + (k0 - lo - i0), b + (k1 - lo - i1), to + k0);
+            }
+        });
+        std::swap(from, to);
+    }
+    if (from != values.data()) values.swap(buffer);
+}
+
+} // namespace parallel_sort
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "json.hpp"
+
+/**
+ * Record List
+ * Persistent list of immutable, shared records for the array sections of a
+ * snapshot. Records are held by pointer in chunks of at most CHUNK_SIZE, under
+ * a root table of chunk pointers. Copying a list copies one pointer; an edit
+ * copies the root table and the one chunk it touches, never a record, so the
+ * new version shares everything else with the old one. Two versions of a list
+ * are compared chunk by chunk, and the chunks they share are skipped whole,
+ * so edits far apart show up as separate small differences.
+ * Lookup by index is a binary search over the chunk ends.
+ */
+class RecordList {
+public:
+    using Record = std::shared_ptr<const nlohmann::json>;
+    static constexpr size_t CHUNK_SIZE = 64;
+
+private:
+    using Chunk = std::vector<Record>;
+
+    struct Root {
+        std::vector<std::shared_ptr<const Chunk>> chunks;  // never empty chunks
+        std::vector<size_t> ends;                          // ends[c] = records in chunks [0, c]
+    };
+
+    std::shared_ptr<const Root> root;  // null while empty
+
+    const Root& data() const {
+        static const Root empty;
+        return root ? *root : empty;
+    }
+
+    /**
+     * Chunk holding the record at index (< size())
+     */
+    size_t chunkOf(size_t index) const {
+        const auto& ends = root->ends;
+        return static_cast<size_t>(std::upper_bound(ends.begin(), ends.end(), index) - ends.begin());
+    }
+
+    size_t chunkBegin(size_t chunk) const {
+        return chunk == 0 ? 0 : data().ends[chunk - 1];
+    }
+
+    /**
+     * Fresh copy of the root table for an edit; readers of the old version
+     * keep theirs
+     */
+    Root& editRoot() {
+        auto copy = root ? std::make_shared<Root>(*root) : std::make_shared<Root>();
+        Root& edited = *copy;
+        root = std::move(copy);
+        return edited;
+    }
+
+    static void recount(Root& edited, size_t from) {
+        edited.ends.resize(edited.chunks.size());
+        for (size_t c = from; c < edited.chunks.size(); ++c) {
+            edited.ends[c] = (c == 0 ? 0 : edited.ends[c - 1]) + edited.chunks[c]->size();
+        }
+    }
+
+    /**
+     * Replace chunk c by its edited copy: split when it outgrew CHUNK_SIZE,
+     * dropped when empty, merged into a neighbour once it shrinks below a
+     * quarter so erasures do not leave a trail of tiny chunks
+     */
+    void replaceChunk(Root& edited, size_t c, Chunk chunk) {
+        auto& chunks = edited.chunks;
+        if (chunk.size() > CHUNK_SIZE) {
+            Chunk upper(chunk.begin() + chunk.size() / 2, chunk.end());
+            chunk.resize(chunk.size() / 2);
+            chunks[c] = std::make_shared<const Chunk>(std::move(chunk));
+            chunks.insert(chunks.begin() + c + 1, std::make_shared<const Chunk>(std::move(upper)));
+        }
+        else if (chunk.empty()) {
+            chunks.erase(chunks.begin() + c);
+        }
+        else if (chunk.size() < CHUNK_SIZE / 4 && chunks.size() > 1) {
+            size_t left = c > 0 ? c - 1 : c;
+            size_t right = left + 1;
+            const Chunk& neighbour = *chunks[c == left ? right : left];
+            if (neighbour.size() + chunk.size() <= CHUNK_SIZE) {
+                Chunk merged;
+                merged.reserve(neighbour.size() + chunk.size());
+                const Chunk& first = c == left ? chunk : neighbour;
+                const Chunk& second = c == left ? neighbour : chunk;
+                merged.insert(merged.end(), first.begin(), first.end());
+                merged.insert(merged.end(), second.begin(), second.end());
+                chunks[left] = std::make_shared<const Chunk>(std::move(merged));
+                chunks.erase(chunks.begin() + right);
+                c = left;
+            }
+            else {
+                chunks[c] = std::make_shared<const Chunk>(std::move(chunk));
+            }
+        }
+        else {
+            chunks[c] = std::make_shared<const Chunk>(std::move(chunk));
+        }
+        recount(edited, std::min(c, chunks.size()));
+        if (chunks.empty()) root.reset();
+    }
+
+    static constexpr size_t NEARBY_CHUNKS = 4;
+
+    static bool sameRecord(const Record& a, const Record& b) {
+        return a == b || *a == *b;
+    }
+
+public:
+    class const_iterator {
+        const Root* list = nullptr;
+        size_t chunk = 0;
+        size_t offset = 0;
+
+        friend class RecordList;
+        const_iterator(const Root* list, size_t chunk, size_t offset) : list(list), chunk(chunk), offset(offset) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = nlohmann::json;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const nlohmann::json*;
+        using reference = const nlohmann::json&;
+
+        const_iterator() = default;
+        reference operator*() const { return *(*list->chunks[chunk])[offset]; }
+        pointer operator->() const { return &**this; }
+        const Record& record() const { return (*list->chunks[chunk])[offset]; }
+
+        const_iterator& operator++() {
+            if (++offset == list->chunks[chunk]->size()) {
+                chunk++;
+                offset = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator before = *this;
+            ++*this;
+            return before;
+        }
+
+        bool operator==(const const_iterator& other) const { return chunk == other.chunk && offset == other.offset; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    RecordList() = default;
+
+    /**
+     * List taking over the elements of a JSON array
+     */
+    static RecordList fromJson(nlohmann::json&& array) {
+        RecordList list;
+        if (!array.is_array() || array.empty()) return list;
+        Root& edited = list.editRoot();
+        Chunk chunk;
+        for (auto& value : array) {
+            chunk.push_back(std::make_shared<const nlohmann::json>(std::move(value)));
+            if (chunk.size() == CHUNK_SIZE) {
+                edited.chunks.push_back(std::make_shared<const Chunk>(std::move(chunk)));
+                chunk = Chunk();
+            }
+        }
+        if (!chunk.empty()) edited.chunks.push_back(std::make_shared<const Chunk>(std::move(chunk)));
+        recount(edited, 0);
+        return list;
+    }
+
+    /**
+     * Records [begin, end) as a JSON array
+     */
+    nlohmann::json toJson(size_t begin, size_t end) const {
+        nlohmann::json array = nlohmann::json::array();
+        if (begin >= end) return array;
+        array.get_ref<nlohmann::json::array_t&>().reserve(end - begin);
+        for (auto it = iteratorAt(begin); begin < end; ++it, ++begin) array.push_back(*it);
+        return array;
+    }
+
+    nlohmann::json toJson() const { return toJson(0, size()); }
+
+    size_t size() const { return root ? root->ends.back() : 0; }
+    bool empty() const { return !root; }
+
+    const Record& record(size_t index) const {
+        size_t c = chunkOf(index);
+        return (*root->chunks[c])[index - chunkBegin(c)];
+    }
+
+    const nlohmann::json& operator[](size_t index) const { return *record(index); }
+    const nlohmann::json& front() const { return *root->chunks.front()->front(); }
+    const nlohmann::json& back() const { return *root->chunks.back()->back(); }
+
+    const_iterator begin() const { return const_iterator(&data(), 0, 0); }
+    const_iterator end() const { return const_iterator(&data(), data().chunks.size(), 0); }
+
+    /**
+     * Iterator at index (<= size()), found with one search
+     */
+    const_iterator iteratorAt(size_t index) const {
+        if (index >= size()) return end();
+        size_t c = chunkOf(index);
+        return const_iterator(root.get(), c, index - chunkBegin(c));
+    }
+
+    /**
+     * First index at or after from holding a record equal to value, or size()
+     */
+    size_t find(const nlohmann::json& value, size_t from = 0) const {
+        for (auto it = iteratorAt(from); it != end(); ++it, ++from) {
+            if (*it == value) break;
+        }
+        return from;
+    }
+
+    /**
+     * True if both are the same version of a list (not merely equal)
+     */
+    bool sameAs(const RecordList& other) const { return root == other.root; }
+
+    bool operator==(const RecordList& other) const {
+        if (sameAs(other)) return true;
+        if (size() != other.size()) return false;
+        for (auto a = begin(), b = other.begin(); a != end(); ++a, ++b) {
+            if (!sameRecord(a.record(), b.record())) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const RecordList& other) const { return !(*this == other); }
+
+    void push_back(Record record) {
+        if (empty() || root->chunks.back()->size() >= CHUNK_SIZE) {
+            Root& edited = editRoot();
+            edited.chunks.push_back(std::make_shared<const Chunk>(Chunk{std::move(record)}));
+            recount(edited, edited.chunks.size() - 1);
+            return;
+        }
+        insert(size(), std::move(record));
+    }
+
+    /**
+     * Insert before index (<= size())
+     */
+    void insert(size_t index, Record record) {
+        if (empty()) {
+            push_back(std::move(record));
+            return;
+        }
+        // At the end, the record joins the last chunk
+        size_t c = index >= size() ? root->chunks.size() - 1 : chunkOf(index);
+        Chunk chunk = *root->chunks[c];
+        chunk.insert(chunk.begin() + (index - chunkBegin(c)), std::move(record));
+        replaceChunk(editRoot(), c, std::move(chunk));
+    }
+
+    void set(size_t index, Record record) {
+        size_t c = chunkOf(index);
+        Chunk chunk = *root->chunks[c];
+        chunk[index - chunkBegin(c)] = std::move(record);
+        replaceChunk(editRoot(), c, std::move(chunk));
+    }
+
+    void erase(size_t index) {
+        size_t c = chunkOf(index);
+        Chunk chunk = *root->chunks[c];
+        chunk.erase(chunk.begin() + (index - chunkBegin(c)));
+        replaceChunk(editRoot(), c, std::move(chunk));
+    }
+
+    /**
+     * Drop the first count records (<= size()); whole chunks are let go
+     * without copying
+     */
+    void erasePrefix(size_t count) {
+        if (count == 0) return;
+        if (count >= size()) {
+            root.reset();
+            return;
+        }
+        size_t c = chunkOf(count);
+        Chunk rest(root->chunks[c]->begin() + (count - chunkBegin(c)), root->chunks[c]->end());
+        Root& edited = editRoot();
+        edited.chunks.erase(edited.chunks.begin(), edited.chunks.begin() + c);
+        replaceChunk(edited, 0, std::move(rest));
+    }
+
+    /**
+     * Stretch where two lists differ: records [beforeBegin, beforeEnd) of one
+     * stand where the other has [afterBegin, afterEnd)
+     */
+    struct Difference {
+        size_t beforeBegin;
+        size_t beforeEnd;
+        size_t afterBegin;
+        size_t afterEnd;
+    };
+
+    /**
+     * Stretches where after differs from before, in order. Chunks both lists
+     * share are matched by address and skipped without looking at their
+     * records, so for one version derived from the other this costs the
+     * number of chunks plus the records of the chunks that were edited;
+     * lists sharing nothing compare record by record.
+     */
+    static std::vector<Difference> differences(const RecordList& before, const RecordList& after) {
+        const auto& x = before.data().chunks;
+        const auto& y = after.data().chunks;
+        std::unordered_map<const Chunk*, size_t> positions;  // of after's chunks, built if needed
+
+        std::vector<Difference> found;
+        size_t i = 0, j = 0;  // chunks of before and after
+        while (i < x.size() || j < y.size()) {
+            if (i < x.size() && j < y.size() && x[i] == y[j]) {
+                i++;
+                j++;
+                continue;
+            }
+            // Edits never reorder chunks: the next chunk of before that after
+            // still holds ends the stretch in both. An edit replaces, splits or
+            // merges a chunk or two, so that chunk is looked for nearby first.
+            size_t nextI = x.size();
+            size_t nextJ = y.size();
+            for (size_t di = 0; di < NEARBY_CHUNKS && i + di < x.size() && nextI == x.size(); ++di) {
+                for (size_t dj = 0; dj < NEARBY_CHUNKS && j + dj < y.size(); ++dj) {
+                    if (x[i + di] == y[j + dj]) {
+                        nextI = i + di;
+                        nextJ = j + dj;
+                        break;
+                    }
+                }
+            }
+            if (nextI == x.size() && i < x.size() && j < y.size()) {
+                if (positions.empty()) {
+                    for (size_t c = 0; c < y.size(); ++c) positions.emplace(y[c].get(), c);
+                }
+                for (nextI = i; nextI < x.size(); ++nextI) {
+                    auto it = positions.find(x[nextI].get());
+                    if (it != positions.end() && it->second >= j) {
+                        nextJ = it->second;
+                        break;
+                    }
+                }
+            }
+            Difference stretch{before.chunkBegin(i), before.chunkBegin(nextI), after.chunkBegin(j), after.chunkBegin(nextJ)};
+            i = nextI;
+            j = nextJ;
+
+            // Records the edited chunks still share at either end
+            auto left = before.iteratorAt(stretch.beforeBegin);
+            auto right = after.iteratorAt(stretch.afterBegin);
+            while (stretch.beforeBegin < stretch.beforeEnd && stretch.afterBegin < stretch.afterEnd &&
+                   sameRecord(left.record(), right.record())) {
+                ++left;
+                ++right;
+                stretch.beforeBegin++;
+                stretch.afterBegin++;
+            }
+            while (stretch.beforeBegin < stretch.beforeEnd && stretch.afterBegin < stretch.afterEnd &&
+                   sameRecord(before.record(stretch.beforeEnd - 1), after.record(stretch.afterEnd - 1))) {
+                stretch.beforeEnd--;
+                stretch.afterEnd--;
+            }
+            if (stretch.beforeBegin < stretch.beforeEnd || stretch.afterBegin < stretch.afterEnd) found.push_back(stretch);
+        }
+        return found;
+    }
+};
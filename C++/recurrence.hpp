@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include "task_date.hpp"
+
+/**
+ * Recurrence
+ * A recurring task stores only its rule (frequency + anchor deadline); the
+ * occurrences are generated on demand by OccurrenceIterator, so nothing is
+ * materialized into the task file. Monthly rules keep the anchor's day and
+ * clamp it to the length of shorter months (31st -> 30th, 28th/29th).
+ */
+class RecurrenceRule {
+public:
+    enum class Frequency { Daily, Weekly, Monthly };
+
+private:
+    Frequency frequency = Frequency::Daily;
+    TaskDate anchor;
+
+public:
+    class OccurrenceIterator {
+    private:
+        const RecurrenceRule* rule = nullptr;
+        uint32_t index = 0;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = TaskDate;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TaskDate*;
+        using reference = TaskDate;
+
+        OccurrenceIterator() = default;
+        OccurrenceIterator(const RecurrenceRule* owner, uint32_t start) : rule(owner), index(start) {}
+
+        TaskDate operator*() const { return rule->occurrence(index); }
+        uint32_t position() const { return index; }
+
+        OccurrenceIterator& operator++() {
+            index++;
+            return *this;
+        }
+
+        OccurrenceIterator operator++(int) {
+            OccurrenceIterator previous = *this;
+            index++;
+            return previous;
+        }
+
+        bool operator==(const OccurrenceIterator& other) const { return index == other.index; }
+        bool operator!=(const OccurrenceIterator& other) const { return index != other.index; }
+    };
+
+    RecurrenceRule() = default;
+    RecurrenceRule(Frequency every, TaskDate first) : frequency(every), anchor(first) {}
+
+    /**
+     * Parse the stored frequency name ("daily", "weekly", "monthly")
+     */
+    static std::optional<Frequency> parseFrequency(std::string_view name) {
+        if (name == "daily") return Frequency::Daily;
+        if (name == "weekly") return Frequency::Weekly;
+        if (name == "monthly") return Frequency::Monthly;
+        return std::nullopt;
+    }
+
+    static const char* frequencyName(Frequency every) {
+        switch (every) {
+            case Frequency::Daily: return "daily";
+            case Frequency::Weekly: return "weekly";
+            default: return "monthly";
+        }
+    }
+
+    Frequency getFrequency() const { return frequency; }
+    TaskDate getAnchor() const { return anchor; }
+
+    /**
+     * The n-th occurrence (0 is the anchor itself)
+     */
+    TaskDate occurrence(uint32_t n) const {
+        switch (frequency) {
+            case Frequency::Daily:
+                return anchor + static_cast<int32_t>(n);
+            case Frequency::Weekly:
+                return anchor + static_cast<int32_t>(n) * 7;
+            default: {
+                TaskDate::Civil start = anchor.civil();
+                int64_t months = static_cast<int64_t>(start.year) * 12 + (start.month - 1) + n;
+                int year = static_cast<int>(months / 12);
+                unsigned month = static_cast<unsigned>(months % 12) + 1;
+                unsigned day = start.day;
+                unsigned last = TaskDate::daysInMonth(year, month);
+                return TaskDate::fromCivil(year, month, day < last ? day : last);
+            }
+        }
+    }
+
+    /**
+     * Index of the first occurrence on or after day, computed without iterating
+     */
+    uint32_t firstIndexOnOrAfter(TaskDate day) const {
+        if (day <= anchor) return 0;
+        int32_t distance = day - anchor;
+        switch (frequency) {
+            case Frequency::Daily:
+                return static_cast<uint32_t>(distance);
+            case Frequency::Weekly:
+                return static_cast<uint32_t>((distance + 6) / 7);
+            default: {
+                TaskDate::Civil from = anchor.civil();
+                TaskDate::Civil to = day.civil();
+                uint32_t n = static_cast<uint32_t>((to.year - from.year) * 12 + static_cast<int>(to.month) - static_cast<int>(from.month));
+                while (occurrence(n) < day) n++;
+                return n;
+            }
+        }
+    }
+
+    /**
+     * Occurrences starting with the first one on or after day (unbounded)
+     */
+    OccurrenceIterator occurrencesFrom(TaskDate day) const {
+        return OccurrenceIterator(this, firstIndexOnOrAfter(day));
+    }
+
+    /**
+     * First occurrence strictly after day (the next one still pending)
+     */
+    TaskDate nextAfter(TaskDate day) const {
+        return *occurrencesFrom(day + 1);
+    }
+};
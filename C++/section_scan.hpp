@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "structural_index.hpp"
+
+/**
+ * Section Scan
+ * Pass over the structural index of a tasks document that finds where each
+ * top-level member's value starts and ends, and for array members where each
+ * element starts and ends, without building anything. It walks structurals
+ * only, tracking bracket depth, and checks that the bytes between them are
+ * whitespace; the spans are then built independently (and concurrently),
+ * which is where the values themselves are validated. Anything the scan does
+ * not expect (escaped keys, a non-object root, trailing data) makes it give
+ * up so the caller can parse the whole document the ordinary way.
+ */
+namespace section_scan {
+
+constexpr size_t NONE = size_t(-1);
+
+struct Span {
+    size_t begin = 0;
+    size_t end = 0;    // one past the last byte
+    size_t first = 0;  // structurals inside the value are [first, last);
+    size_t last = 0;   // none for a scalar, which lies between two of them
+};
+
+struct Member {
+    std::string key;
+    Span value;
+    bool array = false;
+    std::vector<Span> elements;  // only for arrays
+};
+
+struct Document {
+    std::vector<uint32_t> structurals;
+    std::vector<Member> members;
+};
+
+namespace detail {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool blank(std::string_view text, size_t from, size_t to) {
+    for (; from < to; ++from) {
+        if (!isSpace(text[from])) return false;
+    }
+    return true;
+}
+
+/**
+ * Structural just past the string or container opening at structural i
+ */
+inline size_t skip(std::string_view text, const std::vector<uint32_t>& s, size_t i) {
+    char c = text[s[i]];
+    if (c == '"') return i + 1 < s.size() ? i + 2 : NONE;
+    size_t depth = 0;
+    for (; i < s.size(); ++i) {
+        char ch = text[s[i]];
+        if (ch == '"') i++;  // its closing quote
+        else if (ch == '{' || ch == '[') depth++;
+        else if (ch == '}' || ch == ']') {
+            if (--depth == 0) return i + 1;
+        }
+    }
+    return NONE;
+}
+
+/**
+ * Span of the value that follows byte from: a string or container opening
+ * at structural i (i is moved past it), or a scalar ending before it
+ */
+inline bool value(std::string_view text, const std::vector<uint32_t>& s, size_t from, size_t& i, Span& span) {
+    if (i >= s.size()) return false;
+    char c = text[s[i]];
+    if (c == '"' || c == '{' || c == '[') {
+        if (!blank(text, from, s[i])) return false;
+        size_t next = skip(text, s, i);
+        if (next == NONE) return false;
+        span = {s[i], s[next - 1] + size_t(1), i, next};
+        i = next;
+        return true;
+    }
+    size_t begin = from, end = s[i];
+    while (begin < end && isSpace(text[begin])) begin++;
+    while (end > begin && isSpace(text[end - 1])) end--;
+    if (begin == end) return false;
+    span = {begin, end, i, i};
+    return true;
+}
+
+/**
+ * Element spans of the array opening at structural i; i is moved past its ']'
+ */
+inline bool elements(std::string_view text, const std::vector<uint32_t>& s, size_t& i, std::vector<Span>& out) {
+    size_t from = s[i] + size_t(1);
+    i++;
+    if (i < s.size() && text[s[i]] == ']' && blank(text, from, s[i])) {
+        i++;
+        return true;
+    }
+    while (true) {
+        Span span;
+        if (!value(text, s, from, i, span)) return false;
+        if (i >= s.size() || !blank(text, span.end, s[i])) return false;
+        out.push_back(span);
+        char c = text[s[i]];
+        from = s[i] + size_t(1);
+        i++;
+        if (c == ']') return true;
+        if (c != ',') return false;
+    }
+}
+
+inline bool plainKey(std::string_view key) {
+    for (char c : key) {
+        if (c == '\\' || static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80) return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * Structural index and top-level members of the object document in text
+ */
+inline std::optional<Document> scan(std::string_view text) {
+    using namespace detail;
+    auto index = structural_index::build(text);
+    if (!index) return std::nullopt;
+    Document doc;
+    doc.structurals = std::move(*index);
+    const auto& s = doc.structurals;
+
+    if (s.empty() || text[s[0]] != '{' || !blank(text, 0, s[0])) return std::nullopt;
+    size_t from = s[0] + size_t(1);
+    size_t i = 1;
+    if (i < s.size() && text[s[i]] == '}' && blank(text, from, s[i])) {
+        if (i + 1 != s.size() || !blank(text, s[i] + size_t(1), text.size())) return std::nullopt;
+        return doc;
+    }
+
+    while (true) {
+        if (i + 2 >= s.size() || text[s[i]] != '"' || !blank(text, from, s[i])) return std::nullopt;
+        std::string_view key = text.substr(s[i] + 1, s[i + 1] - s[i] - 1);
+        if (!plainKey(key)) return std::nullopt;
+        if (text[s[i + 2]] != ':' || !blank(text, s[i + 1] + size_t(1), s[i + 2])) return std::nullopt;
+        from = s[i + 2] + size_t(1);
+        i += 3;
+
+        Member member;
+        member.key = std::string(key);
+        if (i < s.size() && text[s[i]] == '[' && blank(text, from, s[i])) {
+            size_t start = i;
+            if (!elements(text, s, i, member.elements)) return std::nullopt;
+            member.array = true;
+            member.value = {s[start], s[i - 1] + size_t(1), start, i};
+        }
+        else if (!value(text, s, from, i, member.value)) {
+            return std::nullopt;
+        }
+        if (i >= s.size() || !blank(text, member.value.end, s[i])) return std::nullopt;
+        doc.members.push_back(std::move(member));
+
+        char c = text[s[i]];
+        from = s[i] + size_t(1);
+        i++;
+        if (c == '}') {
+            if (i != s.size() || !blank(text, from, text.size())) return std::nullopt;
+            return doc;
+        }
+        if (c != ',') return std::nullopt;
+    }
+}
+
+} // namespace section_scan
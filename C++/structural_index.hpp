@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define STRUCTURAL_INDEX_HAVE_X86 1
+#endif
+
+/**
+ * Structural Index
+ * First stage of the load path: lists the offsets of every quote and every
+ * { } [ ] : , outside strings, 64 bytes at a time. Each block is turned into
+ * bitmasks (AVX2 or SSE2 compares on x86-64, picked once at runtime, a byte
+ * loop elsewhere); escaped quotes are removed and a prefix XOR of the quote
+ * mask gives the in-string mask that hides structural characters inside
+ * strings. Scalars are not indexed, they are the gaps between structurals.
+ */
+namespace structural_index {
+
+constexpr size_t BLOCK = 64;
+
+namespace detail {
+
+/**
+ * Bitmasks of one 64-byte block, bit i for byte i
+ */
+struct Masks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t op = 0;  // { } [ ] : ,
+};
+
+inline void scalarMasks(const unsigned char* p, size_t blocks, Masks* out) {
+    for (size_t b = 0; b < blocks; ++b, p += BLOCK) {
+        Masks masks;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            unsigned char c = p[i];
+            uint64_t bit = uint64_t(1) << i;
+            if (c == '"') masks.quote |= bit;
+            else if (c == '\\') masks.backslash |= bit;
+            else if ((c | 0x20) == '{' || (c | 0x20) == '}' || c == ':' || c == ',') masks.op |= bit;
+        }
+        out[b] = masks;
+    }
+}
+
+#ifdef STRUCTURAL_INDEX_HAVE_X86
+inline void sse2Masks(const unsigned char* p, size_t blocks, Masks* out) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);  // folds [ ] onto { }
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    for (size_t b = 0; b < blocks; ++b, p += BLOCK) {
+        Masks masks;
+        for (size_t k = 0; k < BLOCK; k += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + k));
+            __m128i folded = _mm_or_si128(v, lower);
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+            masks.quote |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << k;
+            masks.backslash |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << k;
+            masks.op |= uint64_t(uint16_t(_mm_movemask_epi8(op))) << k;
+        }
+        out[b] = masks;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void avx2Masks(const unsigned char* p, size_t blocks, Masks* out) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    for (size_t b = 0; b < blocks; ++b, p += BLOCK) {
+        Masks masks;
+        for (size_t k = 0; k < BLOCK; k += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + k));
+            __m256i folded = _mm256_or_si256(v, lower);
+            __m256i op = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+            masks.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << k;
+            masks.backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << k;
+            masks.op |= uint64_t(uint32_t(_mm256_movemask_epi8(op))) << k;
+        }
+        out[b] = masks;
+    }
+}
+#endif
+
+using Classifier = void (*)(const unsigned char*, size_t, Masks*);
+
+inline Classifier classifier() {
+#ifdef STRUCTURAL_INDEX_HAVE_X86
+    static const Classifier chosen = __builtin_cpu_supports("avx2") ? avx2Masks : sse2Masks;
+    return chosen;
+#else
+    return scalarMasks;
+#endif
+}
+
+inline unsigned lowestBit(uint64_t bits) {
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+    unsigned n = 0;
+    while (!(bits & 1)) bits >>= 1, n++;
+    return n;
+#endif
+}
+
+/**
+ * Bits of characters escaped by a backslash. Backslashes are rare in task
+ * files, so runs are resolved one backslash at a time; carry says the first
+ * byte is escaped by a backslash that ended the previous block.
+ */
+inline uint64_t escapedBits(uint64_t backslash, uint64_t& carry) {
+    uint64_t escaped = carry;
+    backslash &= ~carry;
+    carry = 0;
+    while (backslash) {
+        unsigned bit = lowestBit(backslash);
+        if (bit == 63) {
+            carry = 1;
+            break;
+        }
+        escaped |= uint64_t(1) << (bit + 1);
+        backslash &= ~(uint64_t(3) << bit);  // this backslash and the character it escapes
+    }
+    return escaped;
+}
+
+/**
+ * Bit i set if an odd number of bits at or below i are set in bits
+ */
+inline uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+} // namespace detail
+
+/**
+ * Name of the classification path in use: "avx2", "sse2" or "scalar"
+ */
+inline const char* path() {
+#ifdef STRUCTURAL_INDEX_HAVE_X86
+    return detail::classifier() == detail::avx2Masks ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * Ascending offsets of the structural characters of text (opening and
+ * closing quotes included), or nullopt if a string is left unterminated
+ * or the text is too large for 32-bit offsets
+ */
+inline std::optional<std::vector<uint32_t>> build(std::string_view text) {
+    using namespace detail;
+    if (text.size() > std::numeric_limits<uint32_t>::max()) return std::nullopt;
+
+    std::vector<uint32_t> positions;
+    positions.reserve(text.size() / 8);
+    const Classifier classify = classifier();
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+
+    constexpr size_t BATCH = 1024;  // blocks classified per call
+    Masks masks[BATCH];
+    uint64_t escapeCarry = 0;
+    uint64_t inString = 0;  // all ones while a string continues into the next block
+
+    auto extract = [&](const Masks& block, size_t offset) {
+        uint64_t quotes = block.quote & ~escapedBits(block.backslash, escapeCarry);
+        uint64_t inside = prefixXor(quotes) ^ inString;
+        inString = uint64_t(int64_t(inside) >> 63);
+        uint64_t structural = (block.op & ~inside) | quotes;
+        while (structural) {
+            positions.push_back(static_cast<uint32_t>(offset + lowestBit(structural)));
+            structural &= structural - 1;
+        }
+    };
+
+    size_t full = text.size() / BLOCK;
+    for (size_t first = 0; first < full; first += BATCH) {
+        size_t count = std::min(BATCH, full - first);
+        classify(data + first * BLOCK, count, masks);
+        for (size_t b = 0; b < count; ++b) extract(masks[b], (first + b) * BLOCK);
+    }
+    if (size_t rest = text.size() % BLOCK) {
+        unsigned char tail[BLOCK];
+        std::memset(tail, ' ', BLOCK);
+        std::memcpy(tail, data + full * BLOCK, rest);
+        classify(tail, 1, masks);
+        extract(masks[0], full * BLOCK);
+    }
+    if (inString) return std::nullopt;
+    return positions;
+}
+
+} // namespace structural_index
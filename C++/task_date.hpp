@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+/**
+ * Task Date
+ * Calendar date packed into a 32-bit day number (days since 1970-01-01).
+ * Parses and formats the shared "DD-MM-YYYY" deadline format without
+ * allocating, so sorting, range filters and overdue checks are integer compares.
+ * The on-disk format stays the string form for cross-language compatibility.
+ */
+class TaskDate {
+private:
+    int32_t days = 0;
+
+    explicit constexpr TaskDate(int32_t dayNumber) : days(dayNumber) {}
+
+    /**
+     * Convert two/four ASCII digits; sets bad if any character is not a digit
+     */
+    static constexpr unsigned digits2(const char* p, unsigned& bad) {
+        unsigned a = static_cast<unsigned char>(p[0]) - '0';
+        unsigned b = static_cast<unsigned char>(p[1]) - '0';
+        bad |= (a > 9) | (b > 9);
+        return a * 10 + b;
+    }
+
+    static constexpr unsigned digits4(const char* p, unsigned& bad) {
+        return digits2(p, bad) * 100 + digits2(p + 2, bad);
+    }
+
+    static void put2(char* p, unsigned value) {
+        p[0] = static_cast<char>('0' + value / 10);
+        p[1] = static_cast<char>('0' + value % 10);
+    }
+
+public:
+    struct Civil {
+        int year;
+        unsigned month;
+        unsigned day;
+    };
+
+    constexpr TaskDate() = default;
+
+    static constexpr bool isLeapYear(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    static constexpr unsigned daysInMonth(int year, unsigned month) {
+        constexpr unsigned char lengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && isLeapYear(year) ? 29 : lengths[month - 1];
+    }
+
+    /**
+     * Build from year/month/day (days_from_civil, proleptic Gregorian)
+     */
+    static constexpr TaskDate fromCivil(int year, unsigned month, unsigned day) {
+        year -= month <= 2;
+        const int era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yoe = static_cast<unsigned>(year - era * 400);
+        const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return TaskDate(era * 146097 + static_cast<int32_t>(doe) - 719468);
+    }
+
+    static constexpr TaskDate fromDayNumber(int32_t dayNumber) {
+        return TaskDate(dayNumber);
+    }
+
+    /**
+     * Split back into year/month/day (civil_from_days)
+     */
+    constexpr Civil civil() const {
+        const int32_t z = days + 719468;
+        const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const unsigned doe = static_cast<unsigned>(z - era * 146097);
+        const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned mp = (5 * doy + 2) / 153;
+        const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+        const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+        return {static_cast<int>(yoe) + era * 400 + (month <= 2), month, day};
+    }
+
+    /**
+     * Parse "DD-MM-YYYY"; returns false for malformed or impossible dates
+     */
+    static bool parse(std::string_view text, TaskDate& out) {
+        if (text.size() != 10) return false;
+        const char* p = text.data();
+        unsigned bad = (p[2] != '-') | (p[5] != '-');
+        unsigned day = digits2(p, bad);
+        unsigned month = digits2(p + 3, bad);
+        int year = static_cast<int>(digits4(p + 6, bad));
+        if (bad || month - 1 > 11 || day - 1 >= daysInMonth(year, month)) return false;
+        out = fromCivil(year, month, day);
+        return true;
+    }
+
+    /**
+     * Parse the date part of "YYYY-MM-DD" or an ISO "YYYY-MM-DDTHH:MM:SS" timestamp
+     */
+    static bool parseIso(std::string_view text, TaskDate& out) {
+        if (text.size() < 10) return false;
+        const char* p = text.data();
+        unsigned bad = (p[4] != '-') | (p[7] != '-');
+        int year = static_cast<int>(digits4(p, bad));
+        unsigned month = digits2(p + 5, bad);
+        unsigned day = digits2(p + 8, bad);
+        if (bad || month - 1 > 11 || day - 1 >= daysInMonth(year, month)) return false;
+        out = fromCivil(year, month, day);
+        return true;
+    }
+
+    /**
+     * Local calendar date of a time_t (thread-safe localtime)
+     */
+    static TaskDate fromTime(std::time_t time) {
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        return fromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    }
+
+    /**
+     * Write "DD-MM-YYYY" into a 10-byte buffer (no terminator)
+     */
+    void format(char* out) const {
+        Civil date = civil();
+        put2(out, date.day);
+        out[2] = '-';
+        put2(out + 3, date.month);
+        out[5] = '-';
+        put2(out + 6, static_cast<unsigned>(date.year) / 100);
+        put2(out + 8, static_cast<unsigned>(date.year) % 100);
+    }
+
+    std::string toString() const {
+        char buffer[10];
+        format(buffer);
+        return std::string(buffer, sizeof(buffer));
+    }
+
+    constexpr int32_t dayNumber() const { return days; }
+    constexpr int year() const { return civil().year; }
+
+    constexpr TaskDate operator+(int32_t count) const { return TaskDate(days + count); }
+    constexpr int32_t operator-(TaskDate other) const { return days - other.days; }
+
+    constexpr bool operator==(TaskDate other) const { return days == other.days; }
+    constexpr bool operator!=(TaskDate other) const { return days != other.days; }
+    constexpr bool operator<(TaskDate other) const { return days < other.days; }
+    constexpr bool operator<=(TaskDate other) const { return days <= other.days; }
+    constexpr bool operator>(TaskDate other) const { return days > other.days; }
+    constexpr bool operator>=(TaskDate other) const { return days >= other.days; }
+};
+
+static_assert(sizeof(TaskDate) == 4, "TaskDate must stay a packed 32-bit day number");
+static_assert(TaskDate::fromCivil(1970, 1, 1).dayNumber() == 0, "epoch");
+static_assert(TaskDate::fromCivil(2000, 3, 1).civil().day == 1, "civil round trip");
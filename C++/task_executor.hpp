@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Task Executor
+ * One pool of worker threads shared by every parallel job (shard mounts,
+ * sorts, index builds). Each worker owns a deque: it pushes and pops its own
+ * tasks at the back and, when empty, steals the oldest task from the front of
+ * another worker's deque. A thread waiting for its tasks runs queued work
+ * itself instead of blocking, so jobs may nest (a sort inside a mount task)
+ * without deadlocking even with a single worker.
+ */
+class TaskExecutor {
+public:
+    // Fewest items per piece when parallelFor picks the split itself; below
+    // this, queueing and waking workers costs more than the loop body
+    static constexpr size_t MIN_ITEMS_PER_CHUNK = 2048;
+
+    struct Stats {
+        size_t threads = 0;     // workers plus the calling thread
+        size_t queued = 0;      // tasks waiting in all deques
+        uint64_t executed = 0;  // tasks run, by workers or helping callers
+        uint64_t steals = 0;    // tasks taken from another worker's deque
+    };
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;  // one per worker
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> steals{0};
+    bool stopping = false;
+
+    // Worker identity of the current thread, if it belongs to an executor
+    static inline thread_local const TaskExecutor* currentOwner = nullptr;
+    static inline thread_local size_t currentIndex = 0;
+
+    bool isWorker() const { return currentOwner == this; }
+
+    /**
+     * Pop from the own deque (back), else steal from another (front)
+     */
+    bool take(size_t self, std::function<void()>& task) {
+        size_t count = queues.size();
+        for (size_t k = 0; k < count; ++k) {
+            size_t index = (self + k) % count;
+            Queue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+            bool own = k == 0 && isWorker();
+            if (own) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                if (isWorker()) steals++;
+            }
+            pending--;
+            return true;
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        currentOwner = this;
+        currentIndex = self;
+        std::function<void()> task;
+        while (true) {
+            if (take(self, task)) {
+                task();
+                executed++;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) return;
+        }
+    }
+
+public:
+    /**
+     * threads counts the caller too; 0 means one per hardware thread
+     */
+    explicit TaskExecutor(size_t threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        size_t count = std::max<size_t>(1, threads - 1);
+        for (size_t i = 0; i < count; ++i) queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i + 1 < threads; ++i) workers.emplace_back(&TaskExecutor::run, this, i);
+    }
+
+    ~TaskExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    size_t threadCount() const { return workers.size() + 1; }
+
+    /**
+     * Queue a task (it must not throw): on a worker it goes to that worker's
+     * deque, otherwise the deques are filled round-robin
+     */
+    void submit(std::function<void()> task) {
+        size_t index = isWorker() ? currentIndex : nextQueue++ % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    /**
+     * Run fn(begin, end) over [0, n) in up to chunks contiguous pieces and
+     * wait for all of them, running queued tasks meanwhile; the first
+     * exception thrown by a piece is rethrown here
+     */
+    template <typename Fn>
+    void parallelFor(size_t n, size_t chunks, Fn fn) {
+        chunks = std::max<size_t>(1, std::min(chunks, n));
+        if (chunks == 1 || workers.empty()) {
+            if (n > 0) fn(0, n);
+            executed++;
+            return;
+        }
+
+        struct Group {
+            std::atomic<size_t> remaining;
+            std::mutex mutex;
+            std::condition_variable done;
+            std::exception_ptr failure;
+        };
+        auto group = std::make_shared<Group>();
+        group->remaining = chunks - 1;
+        for (size_t c = 1; c < chunks; ++c) {
+            submit([group, &fn, n, chunks, c] {
+                try {
+                    fn(n * c / chunks, n * (c + 1) / chunks);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(group->mutex);
+                    if (!group->failure) group->failure = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(group->mutex);
+                if (--group->remaining == 0) group->done.notify_all();
+            });
+        }
+
+        std::exception_ptr failure;
+        try {
+            fn(0, n / chunks);
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+        executed++;
+
+        // Help with queued work until the other pieces are finished
+        size_t self = isWorker() ? currentIndex : 0;
+        std::function<void()> task;
+        while (group->remaining > 0) {
+            if (take(self, task)) {
+                task();
+                executed++;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(group->mutex);
+            group->done.wait_for(lock, std::chrono::milliseconds(1), [&] { return group->remaining == 0; });
+        }
+        if (!failure) failure = group->failure;
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    /**
+     * One piece per thread, but never smaller than MIN_ITEMS_PER_CHUNK, so
+     * small inputs run inline on the calling thread
+     */
+    template <typename Fn>
+    void parallelFor(size_t n, Fn fn) {
+        parallelFor(n, std::min(threadCount(), n / MIN_ITEMS_PER_CHUNK), std::move(fn));
+    }
+
+    Stats stats() const {
+        Stats out;
+        out.threads = threadCount();
+        for (const auto& queue : queues) {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            out.queued += queue->tasks.size();
+        }
+        out.executed = executed;
+        out.steals = steals;
+        return out;
+    }
+};
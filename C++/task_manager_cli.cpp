@@ -5,7 +5,45 @@
 #include <chrono>
 #include <ctime>
 #include <csignal>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <array>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+#include <charconv>
+#include <tuple>
 #include "json.hpp"
+#include "task_date.hpp"
+#include "timestamp_service.hpp"
+#include "timing_wheel.hpp"
+#include "recurrence.hpp"
+#include "block_compression.hpp"
+#include "crc32c.hpp"
+#include "task_query.hpp"
+#include "console_buffer.hpp"
+#include "daily_rollup.hpp"
+#include "task_executor.hpp"
+#include "parallel_sort.hpp"
+#include "structural_index.hpp"
+#include "section_scan.hpp"
+#include "record_list.hpp"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 /**
  * Task Manager CLI Implementation
@@ -13,219 +51,3237 @@
  * Author: Hananel Sabag
  */
 
-using json = nlohmann::json;
-using namespace std;
-namespace fs = std::filesystem;
+using json = nlohmann::json;
+using namespace std;
+namespace fs = std::filesystem;
+
+// Global constants for file and program configuration
+const string DATA_DIR = "../data";
+const string TASKS_FILE = DATA_DIR + "/DB_task_manager.json";
+const string CHECKSUM_FILE = DATA_DIR + "/DB_task_manager.crc";
+const string PATCH_LOG_FILE = DATA_DIR + "/DB_task_manager.patches";
+const string ARCHIVE_DIR = DATA_DIR + "/archive";
+const string SHARD_DIR = DATA_DIR + "/shards";
+const string SIGNATURE = "TaskManager";
+const string LANGUAGE = "(CPP-CLI Version)";
+const string AUTHOR = "Hananel Sabag";
+const int RELOAD_DEBOUNCE_MS = 250;
+const int SHUTDOWN_FLUSH_MS = 2000;
+const int SHARED_EXPORT_DELAY_MS = 10000;
+const size_t HISTORY_SEGMENT_SIZE = 256;
+const int COMPLETED_ARCHIVE_AFTER_DAYS = 90;
+const size_t COMPLETED_SHARD_MIN_SIZE = 64;
+const size_t PATCH_LOG_MAX_ENTRIES = 64;
+const size_t UNDO_LIMIT = 100;
+const size_t LIST_PAGE_SIZE = 20;
+const size_t PARALLEL_PARSE_MIN_BYTES = 256 * 1024;
+
+/**
+ * Hands a termination signal from the signal handler to the menu thread.
+ * The handler only stores the signal number and writes one byte to a pipe;
+ * the menu's input wait watches that pipe and runs the cleanup itself.
+ * Without a pipe (pipe() failed, or Windows) the stored number is all there
+ * is, and it is checked whenever a read returns.
+ */
+class ShutdownSignal {
+private:
+    atomic<int> signum{0};
+#ifndef _WIN32
+    int pipeFds[2] = {-1, -1};
+#endif
+
+public:
+    ShutdownSignal() {
+#ifndef _WIN32
+        if (pipe(pipeFds) != 0) pipeFds[0] = pipeFds[1] = -1;
+#endif
+    }
+
+    /**
+     * Called from the signal handler; async-signal-safe
+     */
+    void notify(int number) noexcept {
+        signum = number;
+#ifndef _WIN32
+        if (pipeFds[1] < 0) return;
+        int saved_errno = errno;
+        char byte = 1;
+        (void)!write(pipeFds[1], &byte, 1);
+        errno = saved_errno;
+#endif
+    }
+
+    /**
+     * Number of the signal received, or 0
+     */
+    int received() const {
+        return signum;
+    }
+
+#ifndef _WIN32
+    /**
+     * Descriptor that turns readable once a signal arrives, or -1 without a pipe
+     */
+    int descriptor() const {
+        return pipeFds[0];
+    }
+#endif
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "signal handler needs a lock-free atomic");
+ShutdownSignal shutdownSignal;
+
+/**
+ * Thrown out of a prompt when a termination signal arrives while waiting for
+ * input; not a std::exception, so only the menu loop catches it
+ */
+struct ShutdownRequested {};
+
+/**
+ * Line input for the menu thread. Waits on stdin and the shutdown pipe
+ * together, so a signal ends the wait (ShutdownRequested) instead of the
+ * process exiting under the menu. Lines are split like getline does.
+ */
+class LineReader {
+private:
+    string buffer;
+    size_t start = 0;
+    bool ended = false;
+
+public:
+    /**
+     * Read the next line into line; false at end of input
+     */
+    bool read(string& line) {
+        line.clear();
+        if (ostream* tied = cin.tie()) tied->flush();
+#ifndef _WIN32
+        while (true) {
+            if (shutdownSignal.received()) throw ShutdownRequested();
+            size_t newline = buffer.find('\n', start);
+            if (newline != string::npos) {
+                line.assign(buffer, start, newline - start);
+                start = newline + 1;
+                return true;
+            }
+            if (ended) {
+                if (start == buffer.size()) return false;
+                line.assign(buffer, start, string::npos);
+                start = buffer.size();
+                return true;
+            }
+            buffer.erase(0, start);
+            start = 0;
+
+            // A signal delivered to this thread also ends the poll with EINTR
+            pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {shutdownSignal.descriptor(), POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno != EINTR) ended = true;
+                continue;
+            }
+            if (fds[1].revents) continue;
+            if (fds[0].revents) {
+                char chunk[4096];
+                ssize_t length = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+                if (length > 0) buffer.append(chunk, static_cast<size_t>(length));
+                else if (length == 0 || (errno != EINTR && errno != EAGAIN)) ended = true;
+            }
+        }
+#else
+        // A console control event ends the blocking read
+        if (getline(cin, line)) return true;
+        if (shutdownSignal.received()) throw ShutdownRequested();
+        return false;
+#endif
+    }
+};
+
+/**
+ * Watches the shared tasks file for writes made by other language versions.
+ * Runs an inotify loop on a background thread and fires the callback once the
+ * file has been quiet for RELOAD_DEBOUNCE_MS, so a burst of writes triggers a
+ * single reload. On platforms without inotify the watcher is a no-op.
+ */
+class DatabaseWatcher {
+private:
+    function<void()> onChange;
+    thread worker;
+    atomic<bool> running{false};
+#ifdef __linux__
+    int inotifyFd = -1;
+    int wakePipe[2] = {-1, -1};
+
+    /**
+     * Returns true if the inotify buffer holds an event for the tasks file
+     */
+    bool drainEvents() {
+        alignas(inotify_event) char buffer[4096];
+        string target = fs::path(TASKS_FILE).filename().string();
+        bool touched = false;
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length; ) {
+                auto* event = reinterpret_cast<inotify_event*>(ptr);
+                if (event->len > 0 && target == event->name) touched = true;
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        return touched;
+    }
+
+    /**
+     * Poll loop: wait for file events, then for a quiet period before notifying
+     */
+    void run() {
+        using clock = chrono::steady_clock;
+        optional<clock::time_point> deadline;
+
+        while (running) {
+            int timeout = -1;
+            if (deadline) {
+                auto remaining = chrono::duration_cast<chrono::milliseconds>(*deadline - clock::now());
+                timeout = max(0, static_cast<int>(remaining.count()));
+            }
+
+            pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+            int ready = poll(fds, 2, timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (fds[1].revents & POLLIN) break;
+
+            if (fds[0].revents & POLLIN) {
+                if (drainEvents()) {
+                    deadline = clock::now() + chrono::milliseconds(RELOAD_DEBOUNCE_MS);
+                }
+            }
+            else if (deadline && clock::now() >= *deadline) {
+                deadline.reset();
+                onChange();
+            }
+        }
+    }
+#endif
+
+public:
+    explicit DatabaseWatcher(function<void()> callback) : onChange(move(callback)) {}
+
+    ~DatabaseWatcher() {
+        stop();
+    }
+
+    /**
+     * Start watching the data directory (the file itself may be replaced by rename)
+     */
+    void start() {
+#ifdef __linux__
+        if (running) return;
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) return;
+        if (inotify_add_watch(inotifyFd, DATA_DIR.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+            pipe(wakePipe) != 0) {
+            close(inotifyFd);
+            inotifyFd = -1;
+            return;
+        }
+        running = true;
+        worker = thread(&DatabaseWatcher::run, this);
+#endif
+    }
+
+    /**
+     * Stop the watcher thread and release its descriptors
+     */
+    void stop() {
+#ifdef __linux__
+        if (!running.exchange(false)) return;
+        char byte = 0;
+        (void)!write(wakePipe[1], &byte, 1);
+        if (worker.joinable()) worker.join();
+        close(inotifyFd);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        inotifyFd = wakePipe[0] = wakePipe[1] = -1;
+#endif
+    }
+};
+
+/**
+ * Deadline reminders for open tasks.
+ * Each task gets a "due soon" timer at the start of the day before its deadline
+ * and an "overdue" timer at the start of the day after it, held in a TimingWheel
+ * of one-minute ticks. A dedicated thread advances the wheel and hands fired
+ * reminders to the callback, so nothing ever scans the open task list.
+ * A task already overdue when scheduled is reminded at once. Each reminder is
+ * delivered once per process, however often the tasks are rescheduled.
+ */
+class ReminderScheduler {
+public:
+    struct Reminder {
+        string key;
+        string name;
+        string deadline;
+        bool overdue = false;
+    };
+
+private:
+    using Wheel = TimingWheel<Reminder>;
+    static constexpr time_t TICK_SECONDS = 60;
+
+    function<void(const Reminder&)> onFire;
+    mutex wheelMutex;
+    condition_variable wakeup;
+    Wheel wheel{currentTick()};
+    unordered_map<string, vector<array<Wheel::Handle, 2>>> handles;
+    set<string> delivered;  // sentKey of every reminder fired so far
+    thread worker;
+    bool stopping = false;
+
+    /**
+     * Identity of one reminder: task, deadline and kind
+     */
+    static string sentKey(const Reminder& reminder) {
+        return reminder.key + '\x1e' + reminder.deadline + (reminder.overdue ? "\x1eoverdue" : "");
+    }
+
+    static uint64_t currentTick() {
+        return static_cast<uint64_t>(time(nullptr) / TICK_SECONDS);
+    }
+
+    /**
+     * First tick of a local calendar day
+     */
+    static uint64_t tickOfDay(TaskDate day) {
+        time_t midnight = static_cast<time_t>(day.dayNumber()) * 86400;
+        midnight -= TimestampService::utcOffset(midnight);
+        return static_cast<uint64_t>(max<time_t>(midnight, 0) / TICK_SECONDS);
+    }
+
+    /**
+     * Reminder thread: advance the wheel once per tick and deliver fired timers
+     */
+    void run() {
+        unique_lock<mutex> lock(wheelMutex);
+        while (!stopping) {
+            vector<Reminder> fired;
+            wheel.advance(currentTick(), [&](Reminder& reminder, uint64_t, Wheel::Handle handle) {
+                // The overdue timer is a task's last: forget the pair it belongs to
+                auto it = reminder.overdue ? handles.find(reminder.key) : handles.end();
+                if (it != handles.end()) {
+                    auto& pairs = it->second;
+                    pairs.erase(remove_if(pairs.begin(), pairs.end(), [&](const auto& pair) { return pair[1] == handle; }), pairs.end());
+                    if (pairs.empty()) handles.erase(it);
+                }
+                delivered.insert(sentKey(reminder));
+                fired.push_back(move(reminder));
+            });
+
+            if (!fired.empty()) {
+                lock.unlock();
+                for (const auto& reminder : fired) onFire(reminder);
+                lock.lock();
+            }
+
+            auto next = chrono::system_clock::from_time_t(static_cast<time_t>((currentTick() + 1) * TICK_SECONDS));
+            wakeup.wait_until(lock, next);
+        }
+    }
+
+public:
+    explicit ReminderScheduler(function<void(const Reminder&)> callback) : onFire(move(callback)) {}
+
+    ~ReminderScheduler() {
+        stop();
+    }
+
+    /**
+     * Identity of a task across snapshots (records have no id field)
+     */
+    static string keyOf(const json& task) {
+        return task.value("name", "") + '\x1f' + task.value("created_at", "");
+    }
+
+    /**
+     * Schedule reminders for an open task due on the given day. One that is
+     * already due is delivered at once, unless it was delivered before.
+     */
+    void schedule(const json& task, TaskDate deadline) {
+        uint64_t now = currentTick();
+        uint64_t due_soon = tickOfDay(deadline + -1);
+        uint64_t overdue = tickOfDay(deadline + 1);
+
+        string key = keyOf(task);
+        Reminder reminder{key, task.value("name", ""), deadline.toString(), overdue <= now};
+        bool send_now = false;
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            array<Wheel::Handle, 2> pair = {Wheel::INVALID_HANDLE, Wheel::INVALID_HANDLE};
+            if (due_soon <= now) send_now = delivered.insert(sentKey(reminder)).second;
+            else pair[0] = wheel.schedule(due_soon, reminder);
+            if (!reminder.overdue) {
+                Reminder late = reminder;
+                late.overdue = true;
+                pair[1] = wheel.schedule(overdue, move(late));
+                handles[key].push_back(pair);
+            }
+        }
+        if (send_now) onFire(reminder);
+    }
+
+    /**
+     * Cancel the reminders of a task that was completed or deleted
+     */
+    void cancel(const json& task) {
+        lock_guard<mutex> lock(wheelMutex);
+        auto it = handles.find(keyOf(task));
+        if (it == handles.end()) return;
+        for (auto handle : it->second.back()) wheel.cancel(handle);
+        it->second.pop_back();
+        if (it->second.empty()) handles.erase(it);
+    }
+
+    /**
+     * Drop every pending reminder (delivered ones stay remembered)
+     */
+    void clear() {
+        lock_guard<mutex> lock(wheelMutex);
+        for (auto& [key, pairs] : handles) {
+            for (auto& pair : pairs) {
+                for (auto handle : pair) wheel.cancel(handle);
+            }
+        }
+        handles.clear();
+    }
+
+    void start() {
+        if (!worker.joinable()) worker = thread(&ReminderScheduler::run, this);
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> lock(wheelMutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+};
+
+/**
+ * Encode a record array as a block-compressed container, one record per line
+ */
+string packRecords(const json& records) {
+    block_compression::BlockWriter writer;
+    for (const auto& record : records) writer.add(record.dump());
+    return writer.finish();
+}
+
+/**
+ * Decode one decompressed block back into its record array
+ */
+json unpackBlock(const string& block) {
+    json records = json::array();
+    for (size_t start = 0; start < block.size(); ) {
+        size_t end = block.find('\n', start);
+        if (end == string::npos) end = block.size();
+        records.push_back(json::parse(block.begin() + start, block.begin() + end));
+        start = end + 1;
+    }
+    return records;
+}
+
+/**
+ * Decode a whole record file: a block container, or the plain JSON of a
+ * per-section shard
+ */
+json unpackRecords(string bytes) {
+    if (!block_compression::BlockReader::isContainer(bytes)) return json::parse(bytes);
+    block_compression::BlockReader reader(move(bytes));
+    json records = json::array();
+    for (size_t i = 0; i < reader.blockCount(); ++i) {
+        for (auto& record : unpackBlock(reader.block(i))) records.push_back(move(record));
+    }
+    return records;
+}
+
+/**
+ * Second stage of the load path: builds values straight from a span of the
+ * structural index, without tokenizing the bytes again. It accepts only what
+ * json::parse accepts and builds the same value; whatever it does not handle
+ * itself (floats, big numbers, nesting past MAX_DEPTH, anything malformed)
+ * sends that whole span to json::parse, which builds it or throws the usual
+ * parse error.
+ */
+class RecordBuilder {
+private:
+    // Nesting the builder recurses through before handing the span to
+    // json::parse, whose parser keeps its own stack on the heap
+    static constexpr size_t MAX_DEPTH = 64;
+
+    const string& text;
+    const vector<uint32_t>& s;  // structural offsets
+
+    char at(size_t i) const { return text[s[i]]; }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    bool blank(size_t from, size_t to) const {
+        for (; from < to; ++from) {
+            if (!isSpace(text[from])) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Length of the well-formed UTF-8 sequence at p (as json::parse checks it), or 0
+     */
+    static size_t utf8Length(const unsigned char* p, const unsigned char* end) {
+        auto follows = [&](size_t k, unsigned char lo = 0x80, unsigned char hi = 0xBF) {
+            return p + k < end && p[k] >= lo && p[k] <= hi;
+        };
+        unsigned char c = p[0];
+        if (c >= 0xC2 && c <= 0xDF) return follows(1) ? 2 : 0;
+        if (c == 0xE0) return follows(1, 0xA0) && follows(2) ? 3 : 0;
+        if (c == 0xED) return follows(1, 0x80, 0x9F) && follows(2) ? 3 : 0;
+        if (c >= 0xE1 && c <= 0xEF) return follows(1) && follows(2) ? 3 : 0;
+        if (c == 0xF0) return follows(1, 0x90) && follows(2) && follows(3) ? 4 : 0;
+        if (c >= 0xF1 && c <= 0xF3) return follows(1) && follows(2) && follows(3) ? 4 : 0;
+        if (c == 0xF4) return follows(1, 0x80, 0x8F) && follows(2) && follows(3) ? 4 : 0;
+        return 0;
+    }
+
+    static bool hex4(const unsigned char* p, const unsigned char* end, uint32_t& value) {
+        if (end - p < 4) return false;
+        value = 0;
+        for (int k = 0; k < 4; ++k) {
+            unsigned char c = p[k];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') digit = (c | 0x20) - 'a' + 10;
+            else return false;
+            value = value << 4 | digit;
+        }
+        return true;
+    }
+
+    static void appendUtf8(string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | cp >> 6);
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | cp >> 12);
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | cp >> 18);
+            out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    /**
+     * Decode the string between the quotes at offsets open and close
+     */
+    bool decode(size_t open, size_t close, string& out) const {
+        const auto* p = reinterpret_cast<const unsigned char*>(text.data()) + open + 1;
+        const auto* end = reinterpret_cast<const unsigned char*>(text.data()) + close;
+        const auto* plain = p;
+        while (plain < end && *plain >= 0x20 && *plain < 0x80 && *plain != '\\') plain++;
+        out.assign(reinterpret_cast<const char*>(p), plain - p);
+
+        for (p = plain; p < end; ) {
+            unsigned char c = *p;
+            if (c < 0x20) return false;
+            if (c >= 0x80) {
+                size_t length = utf8Length(p, end);
+                if (length == 0) return false;
+                out.append(reinterpret_cast<const char*>(p), length);
+                p += length;
+                continue;
+            }
+            if (c != '\\') {
+                out += static_cast<char>(c);
+                p++;
+                continue;
+            }
+            if (end - p < 2) return false;
+            switch (p[1]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t cp;
+                    if (!hex4(p + 2, end, cp)) return false;
+                    p += 6;
+                    if (cp >= 0xDC00 && cp <= 0xDFFF) return false;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        uint32_t low;
+                        if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !hex4(p + 2, end, low)) return false;
+                        if (low < 0xDC00 || low > 0xDFFF) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                    appendUtf8(out, cp);
+                    continue;
+                }
+                default: return false;
+            }
+            p += 2;
+        }
+        return true;
+    }
+
+    /**
+     * Literals and integers up to 18 digits; everything else is left to json::parse
+     */
+    bool scalar(size_t begin, size_t end, json& out) const {
+        string_view token(text.data() + begin, end - begin);
+        if (token == "true") out = true;
+        else if (token == "false") out = false;
+        else if (token == "null") out = nullptr;
+        else {
+            bool negative = token[0] == '-';
+            size_t digits = token.size() - negative;
+            if (digits == 0 || digits > 18 || (token[negative] == '0' && digits > 1)) return false;
+            uint64_t value = 0;
+            for (size_t k = negative; k < token.size(); ++k) {
+                if (token[k] < '0' || token[k] > '9') return false;
+                value = value * 10 + uint64_t(token[k] - '0');
+            }
+            if (negative) out = -static_cast<int64_t>(value);
+            else out = value;
+        }
+        return true;
+    }
+
+    /**
+     * Build the value after byte from: opening at structural i, or a scalar
+     * ending before it. end is set one past its last byte; depth counts the
+     * enclosing objects and arrays.
+     */
+    bool value(size_t& i, size_t from, size_t last, json& out, size_t& end, size_t depth) const {
+        if (i >= last) return false;
+        char c = at(i);
+        if (c == '"' || c == '{' || c == '[') {
+            if (!blank(from, s[i])) return false;
+            if (c == '"') {
+                if (i + 1 >= last) return false;
+                string decoded;
+                if (!decode(s[i], s[i + 1], decoded)) return false;
+                out = move(decoded);
+                end = s[i + 1] + size_t(1);
+                i += 2;
+                return true;
+            }
+            if (depth >= MAX_DEPTH) return false;
+            return c == '{' ? object(i, last, out, end, depth + 1) : array(i, last, out, end, depth + 1);
+        }
+        size_t begin = from;
+        end = s[i];
+        while (begin < end && isSpace(text[begin])) begin++;
+        while (end > begin && isSpace(text[end - 1])) end--;
+        return begin < end && scalar(begin, end, out);
+    }
+
+    bool object(size_t& i, size_t last, json& out, size_t& end, size_t depth) const {
+        out = json::object();
+        size_t from = s[i] + size_t(1);
+        i++;
+        if (i < last && at(i) == '}' && blank(from, s[i])) {
+            end = s[i++] + size_t(1);
+            return true;
+        }
+        while (true) {
+            if (i + 2 >= last || at(i) != '"' || !blank(from, s[i])) return false;
+            string key;
+            if (!decode(s[i], s[i + 1], key)) return false;
+            if (at(i + 2) != ':' || !blank(s[i + 1] + size_t(1), s[i + 2])) return false;
+            from = s[i + 2] + size_t(1);
+            i += 3;
+            json member;
+            size_t memberEnd;
+            if (!value(i, from, last, member, memberEnd, depth)) return false;
+            if (i >= last || !blank(memberEnd, s[i])) return false;
+            out[key] = move(member);
+            char c = at(i);
+            from = s[i++] + size_t(1);
+            if (c == '}') {
+                end = from;
+                return true;
+            }
+            if (c != ',') return false;
+        }
+    }
+
+    bool array(size_t& i, size_t last, json& out, size_t& end, size_t depth) const {
+        out = json::array();
+        size_t from = s[i] + size_t(1);
+        i++;
+        if (i < last && at(i) == ']' && blank(from, s[i])) {
+            end = s[i++] + size_t(1);
+            return true;
+        }
+        while (true) {
+            json element;
+            size_t elementEnd;
+            if (!value(i, from, last, element, elementEnd, depth)) return false;
+            if (i >= last || !blank(elementEnd, s[i])) return false;
+            out.push_back(move(element));
+            char c = at(i);
+            from = s[i++] + size_t(1);
+            if (c == ']') {
+                end = from;
+                return true;
+            }
+            if (c != ',') return false;
+        }
+    }
+
+public:
+    RecordBuilder(const string& text, const vector<uint32_t>& structurals) : text(text), s(structurals) {}
+
+    json build(const section_scan::Span& span) const {
+        json out;
+        size_t i = span.first;
+        size_t end = 0;
+        bool built = span.first == span.last ? scalar(span.begin, span.end, out)
+                                             : value(i, span.begin, span.last, out, end, 0) && i == span.last;
+        if (built) return out;
+        return json::parse(text.begin() + span.begin, text.begin() + span.end);
+    }
+};
+
+/**
+ * Parse a whole tasks document. Large files are cut into their top-level
+ * sections and section arrays into records using the structural index, and
+ * the records are built on the executor; the result is the same document
+ * json::parse would build. Small or unusual files take the plain path.
+ */
+json parseDocument(const string& content, TaskExecutor& executor) {
+    optional<section_scan::Document> doc;
+    if (content.size() >= PARALLEL_PARSE_MIN_BYTES && executor.threadCount() > 1) doc = section_scan::scan(content);
+    if (!doc) return json::parse(content);
+    RecordBuilder builder(content, doc->structurals);
+
+    // One slot per record (or per whole non-array value), filled in parallel
+    vector<json> values(doc->members.size());
+    vector<pair<json*, section_scan::Span>> pieces;
+    for (size_t m = 0; m < doc->members.size(); ++m) {
+        const auto& member = doc->members[m];
+        if (!member.array) {
+            pieces.emplace_back(&values[m], member.value);
+            continue;
+        }
+        values[m] = json::array();
+        auto& records = values[m].get_ref<json::array_t&>();
+        records.resize(member.elements.size());
+        for (size_t e = 0; e < member.elements.size(); ++e) pieces.emplace_back(&records[e], member.elements[e]);
+    }
+    executor.parallelFor(pieces.size(), executor.threadCount() * 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) *pieces[i].first = builder.build(pieces[i].second);
+    });
+
+    json data = json::object();
+    for (size_t m = 0; m < doc->members.size(); ++m) data[doc->members[m].key] = move(values[m]);
+    return data;
+}
+
+/**
+ * Numbered archive segments (<prefix>-000001.blk, ...) holding records rolled
+ * out of the live file, oldest first. Segments are written once (to a temp file,
+ * then renamed) and never rewritten, so archiving costs O(segment) per rollover.
+ */
+class SegmentArchive {
+public:
+    /**
+     * One opened segment; blocks are decompressed only when asked for
+     */
+    class Segment {
+    private:
+        block_compression::BlockReader blocks;
+
+    public:
+        explicit Segment(string bytes) : blocks(move(bytes)) {}
+
+        size_t blockCount() const {
+            return blocks.blockCount();
+        }
+
+        json block(size_t index) const {
+            return unpackBlock(blocks.block(index));
+        }
+    };
+
+private:
+    string prefix;
+    mutable mutex archiveMutex;
+    size_t count = 0;
+
+    string segmentPath(size_t index) const {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "-%06zu", index + 1);
+        return ARCHIVE_DIR + "/" + prefix + suffix + ".blk";
+    }
+
+public:
+    explicit SegmentArchive(string name) : prefix(move(name)) {
+        while (fs::exists(segmentPath(count))) count++;
+    }
+
+    size_t segmentCount() const {
+        lock_guard<mutex> lock(archiveMutex);
+        return count;
+    }
+
+    /**
+     * Write records as the next (newest) segment
+     */
+    void append(const json& records) {
+        lock_guard<mutex> lock(archiveMutex);
+        fs::create_directories(ARCHIVE_DIR);
+        string path = segmentPath(count);
+        {
+            ofstream file(path + ".tmp", ios::trunc | ios::binary);
+            file << packRecords(records);
+            if (!file) throw runtime_error("Cannot write archive segment " + path);
+        }
+        fs::rename(path + ".tmp", path);
+        count++;
+    }
+
+    /**
+     * Open segment index (0 is the oldest)
+     */
+    Segment open(size_t index) const {
+        return Segment(block_compression::BlockReader::readFile(segmentPath(index)));
+    }
+};
+
+/**
+ * Append-only log of RFC 6902 patches against the shared tasks file.
+ * The first line names the file the patches apply to (its CRC32C); each
+ * further line is "<crc32c hex> <patch json>", one per persisted change, so a
+ * torn or damaged tail is detected and cut off on replay. Folding the log
+ * into the shared file is the owner's job; reset() then starts a new log.
+ */
+class PatchLog {
+private:
+    string path;
+    ofstream out;
+    size_t entries = 0;
+
+    static string line(const json& patch) {
+        string text = patch.dump();
+        char crc[16];
+        snprintf(crc, sizeof(crc), "%08x ", Crc32c::compute(text.data(), text.size()));
+        return crc + text + "\n";
+    }
+
+    /**
+     * Apply a patch as a whole: the top-level sections it touches are patched
+     * as copies and put back only once every operation (tests included) has
+     * succeeded, so a failing patch leaves data as it was
+     */
+    static void applyPatch(json& data, const json& patch) {
+        set<string> keys;
+        for (const auto& operation : patch) {
+            const string& path = operation.at("path").get_ref<const string&>();
+            if (path.size() < 2 || path[0] != '/') throw runtime_error("patch must name a section");
+            keys.insert(json::json_pointer(path.substr(0, path.find('/', 1))).back());
+        }
+        json sections = json::object();
+        for (const auto& key : keys) {
+            if (data.contains(key)) sections[key] = data[key];
+        }
+        sections.patch_inplace(patch);
+        for (const auto& key : keys) {
+            if (sections.contains(key)) data[key] = move(sections[key]);
+            else data.erase(key);
+        }
+    }
+
+    /**
+     * Replace the log with a header and the given lines, then reopen for appends
+     */
+    void rewrite(uint32_t base, const vector<string>& lines) {
+        out.close();
+        {
+            ofstream file(path + ".tmp", ios::trunc | ios::binary);
+            file << json({{"format", 1}, {"base_crc32c", base}}).dump() << "\n";
+            for (const auto& text : lines) file << text;
+            if (!file) throw runtime_error("Cannot write patch log " + path);
+        }
+        fs::rename(path + ".tmp", path);
+        out.open(path, ios::app | ios::binary);
+        entries = lines.size();
+    }
+
+public:
+    explicit PatchLog(string file) : path(move(file)) {}
+
+    size_t size() const { return entries; }
+    bool isOpen() const { return out.is_open(); }
+
+    /**
+     * Apply the logged patches to data, which must be the file with CRC base.
+     * A log written against another file is set aside as <log>.stale; replay
+     * stops at the first damaged line or failing patch and the log is cut
+     * back to that point.
+     */
+    size_t replay(json& data, uint32_t base) {
+        vector<string> valid;
+        ifstream file(path, ios::binary);
+        string text;
+        bool matches = false;
+        if (file && getline(file, text)) {
+            try {
+                matches = json::parse(text).value("base_crc32c", uint32_t(0)) == base;
+            }
+            catch (const json::exception&) {
+            }
+        }
+        if (file && !matches) {
+            file.close();
+            error_code ec;
+            fs::rename(path, path + ".stale", ec);
+            cout << "\nWarning: unapplied changes in " << path << " belong to an older tasks file; kept as "
+                 << path << ".stale\n";
+        }
+
+        bool damaged = false;
+        while (matches && getline(file, text)) {
+            try {
+                if (text.size() < 10 || text[8] != ' ') throw runtime_error("short line");
+                uint32_t crc = static_cast<uint32_t>(stoul(text.substr(0, 8), nullptr, 16));
+                if (crc != Crc32c::compute(text.data() + 9, text.size() - 9)) throw runtime_error("checksum");
+                applyPatch(data, json::parse(text.begin() + 9, text.end()));
+                valid.push_back(text + "\n");
+            }
+            catch (const exception&) {
+                damaged = true;
+                break;
+            }
+        }
+        file.close();
+
+        if (damaged) cout << "\nWarning: the patch log ended in a damaged entry; it was dropped.\n";
+        rewrite(base, valid);
+        return valid.size();
+    }
+
+    /**
+     * Append one patch and flush it to the file
+     */
+    void append(const json& patch) {
+        out << line(patch);
+        out.flush();
+        if (!out) throw runtime_error("Cannot append to patch log " + path);
+        entries++;
+    }
+
+    /**
+     * Start an empty log for the file with CRC base (after folding)
+     */
+    void reset(uint32_t base) {
+        rewrite(base, {});
+    }
+
+    /**
+     * Remove the log entirely (the sharded layout does not use it)
+     */
+    void discard() {
+        out.close();
+        entries = 0;
+        error_code ec;
+        fs::remove(path, ec);
+    }
+};
+
+/**
+ * Immutable, versioned view of the task database.
+ * Array sections are RecordLists, so a new version shares every record and
+ * chunk its edit did not touch; other sections (metadata) are shared whole
+ * and copied when changed. Readers and the persistence thread never block.
+ */
+struct TaskSnapshot {
+    /**
+     * One top-level member of the task document
+     */
+    struct Section {
+        RecordList records;
+        shared_ptr<const json> value;  // null for an array section
+
+        /**
+         * Section holding a top-level value: arrays as a record list
+         */
+        static Section of(json&& data) {
+            Section section;
+            if (data.is_array()) section.records = RecordList::fromJson(move(data));
+            else section.value = make_shared<const json>(move(data));
+            return section;
+        }
+
+        bool isRecords() const { return !value; }
+        bool sameAs(const Section& other) const { return value == other.value && records.sameAs(other.records); }
+
+        bool operator==(const Section& other) const {
+            return value && other.value ? *value == *other.value : !value && !other.value && records == other.records;
+        }
+
+        bool operator!=(const Section& other) const { return !(*this == other); }
+
+        json toJson() const { return value ? *value : records.toJson(); }
+    };
+
+    uint64_t version = 0;
+    map<string, Section> sections;
+
+    const RecordList& records(const string& key) const {
+        return sections.at(key).records;
+    }
+
+    const json& metadata() const {
+        return *sections.at("metadata").value;
+    }
+};
+
+/**
+ * Pretty printer for task file values, byte for byte what the json serializer
+ * writes at indent 4. Keys of the task schema are written from literals fixed
+ * at compile time and plain ASCII strings are copied without escaping; other
+ * strings and floats go through the serializer itself.
+ */
+class SnapshotWriter {
+private:
+    // Written form of the known keys, sorted by key
+    static constexpr string_view KEY_LITERALS[] = {
+        "\"activity_history\": ", "\"author\": ", "\"completed_at\": ", "\"completed_tasks\": ",
+        "\"completed_through\": ", "\"created_at\": ", "\"deadline\": ", "\"frequency\": ",
+        "\"language\": ", "\"last_modified\": ", "\"metadata\": ", "\"name\": ", "\"open_tasks\": ",
+        "\"priority\": ", "\"program\": ", "\"recurrence\": ", "\"signature\": ", "\"stats\": ",
+        "\"status\": ", "\"timestamp\": "
+    };
+
+    static constexpr string_view keyOf(string_view literal) {
+        return literal.substr(1, literal.size() - 4);
+    }
+
+    string& out;
+    nlohmann::detail::serializer<json> serializer;
+
+    /**
+     * True if the serializer would copy s unchanged
+     */
+    static bool plain(const string& s) {
+        for (unsigned char c : s) {
+            if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') return false;
+        }
+        return true;
+    }
+
+    template <typename Integer>
+    void writeInteger(Integer value) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+public:
+    explicit SnapshotWriter(string& out) : out(out), serializer(nlohmann::detail::output_adapter<char>(out), ' ') {}
+
+    /**
+     * Write "key": with the separator the serializer puts after it
+     */
+    void key(const string& name) {
+        auto it = lower_bound(begin(KEY_LITERALS), end(KEY_LITERALS), name,
+                              [](string_view literal, const string& k) { return keyOf(literal) < k; });
+        if (it != end(KEY_LITERALS) && keyOf(*it) == name) {
+            out += *it;
+        }
+        else if (plain(name)) {
+            out += '"';
+            out += name;
+            out += "\": ";
+        }
+        else {
+            out += json(name).dump();
+            out += ": ";
+        }
+    }
+
+    /**
+     * Write value as if it were nested indent spaces deep
+     */
+    void write(const json& value, unsigned indent) {
+        switch (value.type()) {
+            case json::value_t::object: {
+                const auto& members = value.get_ref<const json::object_t&>();
+                if (members.empty()) {
+                    out += "{}";
+                    return;
+                }
+                out += "{\n";
+                bool first = true;
+                for (const auto& [name, member] : members) {
+                    if (!first) out += ",\n";
+                    first = false;
+                    out.append(indent + 4, ' ');
+                    key(name);
+                    write(member, indent + 4);
+                }
+                out += '\n';
+                out.append(indent, ' ');
+                out += '}';
+                return;
+            }
+            case json::value_t::array: {
+                const auto& elements = value.get_ref<const json::array_t&>();
+                if (elements.empty()) {
+                    out += "[]";
+                    return;
+                }
+                out += "[\n";
+                for (size_t i = 0; i < elements.size(); ++i) {
+                    if (i > 0) out += ",\n";
+                    out.append(indent + 4, ' ');
+                    write(elements[i], indent + 4);
+                }
+                out += '\n';
+                out.append(indent, ' ');
+                out += ']';
+                return;
+            }
+            case json::value_t::string: {
+                const auto& text = value.get_ref<const json::string_t&>();
+                if (!plain(text)) break;
+                out += '"';
+                out += text;
+                out += '"';
+                return;
+            }
+            case json::value_t::number_integer:
+                writeInteger(value.get<int64_t>());
+                return;
+            case json::value_t::number_unsigned:
+                writeInteger(value.get<uint64_t>());
+                return;
+            case json::value_t::boolean:
+                out += value.get<bool>() ? "true" : "false";
+                return;
+            case json::value_t::null:
+                out += "null";
+                return;
+            default:
+                break;
+        }
+        serializer.dump(value, true, false, 4, indent);
+    }
+};
+
+/**
+ * Write a snapshot in the same layout as `file << setw(4) << data`
+ * With checksums, also collects the CRC32C of every array record's bytes
+ */
+void writeSnapshot(string& out, const TaskSnapshot& snapshot, json* checksums = nullptr) {
+    SnapshotWriter writer(out);
+    if (checksums) *checksums = json::object();
+    out += "{";
+    bool first = true;
+    for (const auto& [key, section] : snapshot.sections) {
+        out += first ? "\n    " : ",\n    ";
+        writer.key(key);
+        first = false;
+        if (!section.isRecords()) {
+            writer.write(*section.value, 4);
+            continue;
+        }
+        if (section.records.empty()) {
+            out += "[]";
+            continue;
+        }
+
+        // Same bytes as the pretty printer, one element at a time
+        json* crcs = checksums ? &((*checksums)[key] = json::array()) : nullptr;
+        out += "[\n";
+        size_t remaining = section.records.size();
+        for (const auto& record : section.records) {
+            out += "        ";
+            size_t start = out.size();
+            writer.write(record, 8);
+            if (crcs) crcs->push_back(Crc32c::compute(out.data() + start, out.size() - start));
+            out += --remaining > 0 ? ",\n" : "\n";
+        }
+        out += "    ]";
+    }
+    out += first ? "}" : "\n}";
+}
+
+/**
+ * One record-level change to an array section: an insert (only after), an
+ * erase (only before) or a modification (both) at index. The records are
+ * the snapshots' own, shared rather than copied.
+ */
+struct RecordChange {
+    string section;
+    size_t index = 0;
+    RecordList::Record before;
+    RecordList::Record after;
+};
+
+/**
+ * Record-level changes turning one list into another, in an order that can be
+ * applied one after another. Only the stretches where the lists differ are
+ * compared (shared chunks are skipped without looking at them), so an edit
+ * costs its own records and not a comparison of the whole section.
+ */
+vector<RecordChange> diffRecords(const string& section, const RecordList& before, const RecordList& after) {
+    vector<RecordChange> changes;
+    for (const auto& stretch : RecordList::differences(before, after)) {
+        // Earlier stretches are applied by now, so this one starts where it does in after
+        size_t at = stretch.afterBegin;
+        size_t removed = stretch.beforeEnd - stretch.beforeBegin;
+        size_t added = stretch.afterEnd - stretch.afterBegin;
+        size_t common = min(removed, added);
+        for (size_t i = 0; i < common; ++i) {
+            changes.push_back({section, at + i, before.record(stretch.beforeBegin + i), after.record(stretch.afterBegin + i)});
+        }
+        for (size_t i = removed; i-- > common; ) changes.push_back({section, at + i, before.record(stretch.beforeBegin + i), nullptr});
+        for (size_t i = common; i < added; ++i) changes.push_back({section, at + i, nullptr, after.record(stretch.afterBegin + i)});
+    }
+    return changes;
+}
+
+/**
+ * Apply a change to its section list. Erased and modified records are looked
+ * up by value when they are no longer at the recorded index (other edits may
+ * have shifted the list); returns false if the record is gone.
+ */
+bool applyRecordChange(RecordList& records, const RecordChange& change) {
+    if (!change.before) {
+        records.insert(min(change.index, records.size()), change.after);
+        return true;
+    }
+    size_t at = change.index;
+    if (at >= records.size() || (records.record(at) != change.before && records[at] != *change.before)) {
+        at = records.find(*change.before);
+        if (at == records.size()) return false;
+    }
+    if (change.after) records.set(at, change.after);
+    else records.erase(at);
+    return true;
+}
+
+/**
+ * Undo/redo stacks of user edits. An entry holds only the records the edit
+ * touched, never a copy of the data, so memory grows with the edits made and
+ * not with the database; the oldest entries beyond UNDO_LIMIT are dropped.
+ */
+class UndoHistory {
+public:
+    struct Entry {
+        string label;
+        vector<RecordChange> changes;
+    };
+
+private:
+    deque<Entry> undoable;
+    vector<Entry> redoable;
+
+    void pushUndo(Entry entry) {
+        undoable.push_back(move(entry));
+        if (undoable.size() > UNDO_LIMIT) undoable.pop_front();
+    }
+
+public:
+    /**
+     * Record a new edit; anything that could be redone is forgotten
+     */
+    void record(Entry entry) {
+        redoable.clear();
+        pushUndo(move(entry));
+    }
+
+    /**
+     * Entry the next undo (redo) would apply, or null; it stays on its stack
+     * until undone() (redone()) reports that it was applied
+     */
+    const Entry* nextUndo() const { return undoable.empty() ? nullptr : &undoable.back(); }
+    const Entry* nextRedo() const { return redoable.empty() ? nullptr : &redoable.back(); }
+
+    void undone() {
+        redoable.push_back(move(undoable.back()));
+        undoable.pop_back();
+    }
+
+    void redone() {
+        Entry entry = move(redoable.back());
+        redoable.pop_back();
+        pushUndo(move(entry));
+    }
+
+    /**
+     * The changes that revert an entry: reverse order, before and after swapped
+     */
+    static vector<RecordChange> inverse(const Entry& entry) {
+        vector<RecordChange> changes(entry.changes.rbegin(), entry.changes.rend());
+        for (auto& change : changes) swap(change.before, change.after);
+        return changes;
+    }
+};
+
+/**
+ * Seconds since the epoch of a record's local "YYYY-MM-DDTHH:MM:SS" timestamp
+ */
+optional<int64_t> localSeconds(const json& record, const char* key) {
+    auto it = record.find(key);
+    if (it == record.end() || !it->is_string()) return nullopt;
+    const string& text = it->get_ref<const string&>();
+    TaskDate day;
+    if (text.size() < 19 || text[10] != 'T' || !TaskDate::parseIso(text, day)) return nullopt;
+    int64_t seconds = 0;
+    for (size_t pos : {11, 14, 17}) {
+        if (!isdigit(static_cast<unsigned char>(text[pos])) || !isdigit(static_cast<unsigned char>(text[pos + 1]))) return nullopt;
+        seconds = seconds * 60 + (text[pos] - '0') * 10 + (text[pos + 1] - '0');
+    }
+    return int64_t(day.dayNumber()) * 86400 + seconds;
+}
+
+/**
+ * Dashboard counters, kept up to date from the record changes of every edit
+ * and stored in metadata["stats"] so the statistics view never scans the task
+ * lists. Completions stay counted when their records move to the archive.
+ * as_of repeats the metadata last_modified written along with the counters;
+ * once another version saves the file they no longer match and are recounted.
+ */
+class TaskStats {
+public:
+    // Upper bounds of the time-to-complete histogram buckets, in seconds
+    static constexpr array<int64_t, 4> BUCKET_LIMITS = {3600, 86400, 7 * 86400, 30 * 86400};
+    static constexpr array<const char*, 5> BUCKET_NAMES = {"< 1 hour", "< 1 day", "< 1 week", "< 30 days", "30+ days"};
+    static constexpr array<const char*, 4> PRIORITIES = {"other", "low", "medium", "high"};
+
+private:
+    array<int64_t, 4> openByPriority{};     // indexed like PRIORITIES
+    map<int32_t, int64_t> openByDeadline;   // pending deadline day -> open tasks
+    int64_t completed = 0;
+    DailyRollup completedPerDay{TimestampService::today()};  // completions by completed_at day
+    int64_t timedCompletions = 0;
+    int64_t secondsToComplete = 0;
+    array<int64_t, 5> timeHistogram{};
+
+    static size_t priorityIndex(const json& task) {
+        auto it = task.find("priority");
+        if (it == task.end() || !it->is_string()) return 0;
+        for (size_t i = 1; i < PRIORITIES.size(); ++i) {
+            if (it->get_ref<const string&>() == PRIORITIES[i]) return i;
+        }
+        return 0;
+    }
+
+    static void bump(map<int32_t, int64_t>& counts, int32_t key, int sign) {
+        if ((counts[key] += sign) == 0) counts.erase(key);
+    }
+
+    static json countsToJson(const map<int32_t, int64_t>& counts) {
+        json out = json::object();
+        for (const auto& [day, count] : counts) out[TaskDate::fromDayNumber(day).toString()] = count;
+        return out;
+    }
+
+    static map<int32_t, int64_t> countsFromJson(const json& in) {
+        map<int32_t, int64_t> out;
+        for (const auto& [key, count] : in.items()) {
+            TaskDate day;
+            if (!TaskDate::parse(key, day)) throw runtime_error("bad stats day " + key);
+            out[day.dayNumber()] = count.get<int64_t>();
+        }
+        return out;
+    }
+
+public:
+    /**
+     * Add (sign 1) or remove (sign -1) an open task with its pending deadline
+     */
+    void countOpen(const json& task, optional<TaskDate> deadline, int sign) {
+        openByPriority[priorityIndex(task)] += sign;
+        if (deadline) bump(openByDeadline, deadline->dayNumber(), sign);
+    }
+
+    /**
+     * Add (sign 1) or remove (sign -1) a completed task record
+     */
+    void countCompleted(const json& task, int sign) {
+        completed += sign;
+        auto done = localSeconds(task, "completed_at");
+        if (!done) return;
+        completedPerDay.add(TaskDate::fromDayNumber(static_cast<int32_t>(*done / 86400)), sign);
+
+        auto created = localSeconds(task, "created_at");
+        if (!created || *done < *created) return;
+        int64_t elapsed = *done - *created;
+        size_t bucket = 0;
+        while (bucket < BUCKET_LIMITS.size() && elapsed >= BUCKET_LIMITS[bucket]) bucket++;
+        timedCompletions += sign;
+        secondsToComplete += sign * elapsed;
+        timeHistogram[bucket] += sign;
+    }
+
+    int64_t openCount() const {
+        int64_t total = 0;
+        for (int64_t count : openByPriority) total += count;
+        return total;
+    }
+
+    int64_t openWithPriority(size_t index) const { return openByPriority.at(index); }
+
+    /**
+     * Open tasks whose pending deadline falls in [from, to)
+     */
+    int64_t openDueBetween(TaskDate from, TaskDate to) const {
+        int64_t total = 0;
+        for (auto it = openByDeadline.lower_bound(from.dayNumber()); it != openByDeadline.end() && it->first < to.dayNumber(); ++it) {
+            total += it->second;
+        }
+        return total;
+    }
+
+    int64_t openDueBefore(TaskDate day) const {
+        return openDueBetween(TaskDate::fromDayNumber(numeric_limits<int32_t>::min()), day);
+    }
+
+    int64_t completedCount() const { return completed; }
+
+    /**
+     * Monday of the week containing day
+     */
+    static TaskDate weekOf(TaskDate day) {
+        int32_t n = day.dayNumber();
+        return TaskDate::fromDayNumber(n - (n % 7 + 10) % 7);  // day 0 (1970-01-01) was a Thursday
+    }
+
+    int64_t completedInWeekOf(TaskDate day) const {
+        return completedPerDay.between(weekOf(day), weekOf(day) + 7);
+    }
+
+    const DailyRollup& completions() const { return completedPerDay; }
+
+    int64_t timedCount() const { return timedCompletions; }
+    int64_t averageSecondsToComplete() const { return timedCompletions ? secondsToComplete / timedCompletions : 0; }
+    int64_t completedWithin(size_t bucket) const { return timeHistogram.at(bucket); }
+
+    json toJson(const json& asOf) const {
+        json priorities = json::object();
+        for (size_t i = 0; i < PRIORITIES.size(); ++i) priorities[PRIORITIES[i]] = openByPriority[i];
+        json perDay = {{"counts", completedPerDay.dense()}};
+        if (!completedPerDay.empty()) perDay["first_day"] = completedPerDay.first().toString();
+        if (!completedPerDay.sparse().empty()) perDay["outliers"] = countsToJson(completedPerDay.sparse());
+        return {
+            {"as_of", asOf},
+            {"open_by_priority", priorities},
+            {"open_by_deadline", countsToJson(openByDeadline)},
+            {"completed", completed},
+            {"completed_per_day", perDay},
+            {"time_to_complete", {
+                {"count", timedCompletions},
+                {"total_seconds", secondsToComplete},
+                {"histogram", timeHistogram}
+            }}
+        };
+    }
+
+    /**
+     * Counters stored in metadata, if present, well formed and written with
+     * the metadata's current last_modified (and covering open_count tasks)
+     */
+    static optional<TaskStats> fromMetadata(const json& metadata, size_t open_count) {
+        try {
+            auto it = metadata.find("stats");
+            if (it == metadata.end() || !it->is_object() || !metadata.contains("last_modified")
+                || it->value("as_of", json()) != metadata.at("last_modified")) {
+                return nullopt;
+            }
+            const json& in = *it;
+            TaskStats stats;
+            for (size_t i = 0; i < PRIORITIES.size(); ++i) stats.openByPriority[i] = in.at("open_by_priority").at(PRIORITIES[i]).get<int64_t>();
+            stats.openByDeadline = countsFromJson(in.at("open_by_deadline"));
+            stats.completed = in.at("completed").get<int64_t>();
+            const json& perDay = in.at("completed_per_day");
+            // Re-added day by day, so counts saved with an older window (or an
+            // unbounded array) end up dense or sparse per today's window
+            auto counts = perDay.at("counts").get<vector<int32_t>>();
+            if (!counts.empty()) {
+                TaskDate first;
+                if (!TaskDate::parse(perDay.at("first_day").get<string>(), first)) return nullopt;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    if (counts[i]) stats.completedPerDay.add(first + static_cast<int32_t>(i), counts[i]);
+                }
+            }
+            if (perDay.contains("outliers")) {
+                for (const auto& [day, count] : countsFromJson(perDay["outliers"])) {
+                    stats.completedPerDay.add(TaskDate::fromDayNumber(day), static_cast<int32_t>(count));
+                }
+            }
+            const json& timing = in.at("time_to_complete");
+            stats.timedCompletions = timing.at("count").get<int64_t>();
+            stats.secondsToComplete = timing.at("total_seconds").get<int64_t>();
+            stats.timeHistogram = timing.at("histogram").get<array<int64_t, 5>>();
+            if (stats.openCount() != static_cast<int64_t>(open_count)) return nullopt;
+            return stats;
+        }
+        catch (const exception&) {
+            return nullopt;
+        }
+    }
+};
+
+/**
+ * Optional sharded layout under SHARD_DIR: a manifest plus one file per
+ * section, with completed tasks and history split into consecutive runs by
+ * month. Saving compares against the last persisted snapshot and rewrites only
+ * the shards whose content changed; mounting parses all shards in parallel.
+ * The shared tasks file is exported for the other versions separately, at most
+ * SHARED_EXPORT_DELAY_MS after a save and on exit, and the manifest is only
+ * rewritten when the set of shards changes or after an export.
+ */
+class ShardedStore {
+private:
+    struct Run {
+        string file;
+        size_t begin;
+        size_t end;
+    };
+
+    mutable mutex storeMutex;
+    json manifest;
+
+    static string manifestPath() {
+        return SHARD_DIR + "/manifest.json";
+    }
+
+    /**
+     * Shard file prefix and date field for sections split by month
+     */
+    static const char* const* partitionOf(const string& section) {
+        static const char* const completed[] = {"completed", "completed_at"};
+        static const char* const history[] = {"history", "timestamp"};
+        if (section == "completed_tasks") return completed;
+        if (section == "activity_history") return history;
+        return nullptr;
+    }
+
+    /**
+     * Split a record array into runs of consecutive records from the same month
+     */
+    static vector<Run> runsOf(const RecordList& records, const char* const* partition) {
+        vector<Run> runs;
+        map<string, int> seen;
+        string current;
+        size_t i = 0;
+        for (auto record = records.begin(); record != records.end(); ++record, ++i) {
+            string month = "undated";
+            auto it = record->find(partition[1]);
+            if (it != record->end() && it->is_string() && it->get_ref<const string&>().size() >= 7) {
+                month = it->get_ref<const string&>().substr(0, 7);
+            }
+            if (runs.empty() || month != current) {
+                int count = ++seen[month];
+                string file = string(partition[0]) + "-" + month + (count > 1 ? "." + to_string(count) : "") + ".blk";
+                runs.push_back({file, i, i});
+                current = month;
+            }
+            runs.back().end = i + 1;
+        }
+        return runs;
+    }
+
+    static void writeFile(const string& name, const string& content) {
+        string path = SHARD_DIR + "/" + name;
+        {
+            ofstream file(path + ".tmp", ios::trunc | ios::binary);
+            file << content;
+            if (!file) throw runtime_error("Cannot write shard " + path);
+        }
+        fs::rename(path + ".tmp", path);
+    }
+
+    /**
+     * Read a shard; month runs are block containers, other sections plain JSON
+     */
+    static json readFile(const string& name) {
+        return unpackRecords(block_compression::BlockReader::readFile(SHARD_DIR + "/" + name));
+    }
+
+public:
+    static bool exists() {
+        return fs::exists(manifestPath());
+    }
+
+    ShardedStore() {
+        fs::create_directories(SHARD_DIR);
+        if (exists()) {
+            ifstream file(manifestPath());
+            manifest = json::parse(file);
+        }
+        else {
+            manifest = {{"format", 1}, {"sections", json::object()}};
+        }
+    }
+
+    /**
+     * True if the shared tasks file is the one we last exported, i.e. no other
+     * version has written it since and the shards are up to date
+     */
+    bool isSharedFileCurrent() const {
+        lock_guard<mutex> lock(storeMutex);
+        auto it = manifest.find("exported");
+        if (it == manifest.end()) return false;
+        error_code ec;
+        auto size = fs::file_size(TASKS_FILE, ec);
+        if (ec) return false;
+        auto write_time = fs::last_write_time(TASKS_FILE, ec);
+        return !ec && (*it)["size"] == size &&
+               (*it)["write_time"] == static_cast<int64_t>(write_time.time_since_epoch().count());
+    }
+
+    /**
+     * True if a shard was written after the last export of the shared file,
+     * i.e. a run ended before exporting its last changes
+     */
+    bool changedSinceExport() const {
+        lock_guard<mutex> lock(storeMutex);
+        auto it = manifest.find("exported");
+        if (it == manifest.end()) return true;
+        int64_t exported = (*it).at("write_time").get<int64_t>();
+        for (const auto& [section, names] : manifest.at("sections").items()) {
+            for (const auto& name : names) {
+                error_code ec;
+                auto write_time = fs::last_write_time(SHARD_DIR + "/" + name.get<string>(), ec);
+                if (!ec && static_cast<int64_t>(write_time.time_since_epoch().count()) > exported) return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Remember the shared file's size and write time after exporting it
+     */
+    void recordExport() {
+        lock_guard<mutex> lock(storeMutex);
+        error_code ec;
+        auto size = fs::file_size(TASKS_FILE, ec);
+        auto write_time = fs::last_write_time(TASKS_FILE, ec);
+        if (ec) return;
+        manifest["exported"] = {
+            {"size", size},
+            {"write_time", static_cast<int64_t>(write_time.time_since_epoch().count())}
+        };
+        writeFile("manifest.json", manifest.dump(4));
+    }
+
+    /**
+     * Move the shard directory to <shards>.previous (replacing an older copy)
+     * and start an empty layout, so a full reshard never overwrites the only
+     * copy of the shards it replaces; throws if they cannot be moved
+     */
+    void setAside() {
+        lock_guard<mutex> lock(storeMutex);
+        string previous = SHARD_DIR + ".previous";
+        error_code ec;
+        fs::remove_all(previous, ec);
+        fs::rename(SHARD_DIR, previous, ec);
+        if (ec) throw runtime_error("Cannot move " + SHARD_DIR + " aside: " + ec.message());
+        fs::create_directories(SHARD_DIR);
+        manifest = {{"format", 1}, {"sections", json::object()}};
+    }
+
+    /**
+     * Parse every shard concurrently on the executor and reassemble the task
+     * document. Sections with a shard that cannot be read are left out and
+     * named in damaged.
+     */
+    json mount(TaskExecutor& executor, set<string>& damaged) const {
+        vector<pair<string, string>> files;
+        json data = json::object();
+        {
+            lock_guard<mutex> lock(storeMutex);
+            for (const auto& [section, names] : manifest["sections"].items()) {
+                if (partitionOf(section)) data[section] = json::array();
+                for (const auto& name : names) files.emplace_back(section, name.get<string>());
+            }
+        }
+
+        // One task per shard, so idle workers steal the small ones
+        vector<json> parsed(files.size());
+        vector<char> failed(files.size(), 0);
+        executor.parallelFor(files.size(), files.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                try {
+                    parsed[i] = readFile(files[i].second);
+                }
+                catch (const exception&) {
+                    failed[i] = 1;
+                }
+            }
+        });
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (failed[i]) damaged.insert(files[i].first);
+        }
+
+        for (size_t i = 0; i < files.size(); ++i) {
+            const string& section = files[i].first;
+            if (damaged.count(section)) {
+                data.erase(section);
+            }
+            else if (partitionOf(section)) {
+                json& records = data[section];
+                for (auto& record : parsed[i]) records.push_back(move(record));
+            }
+            else {
+                data[section] = move(parsed[i]);
+            }
+        }
+        return data;
+    }
+
+    /**
+     * Write the shards that differ between the previously persisted snapshot
+     * (null for a full write) and the latest one, then the manifest
+     */
+    void save(const TaskSnapshot* previous, const TaskSnapshot& latest) {
+        lock_guard<mutex> lock(storeMutex);
+        json sections = json::object();
+        set<string> keep;
+
+        for (const auto& [key, section] : latest.sections) {
+            const TaskSnapshot::Section* before = nullptr;
+            if (previous) {
+                auto it = previous->sections.find(key);
+                if (it != previous->sections.end()) before = &it->second;
+            }
+            bool unchanged = before && before->sameAs(section);
+            auto partition = partitionOf(key);
+
+            if (!partition || !section.isRecords()) {
+                string file = key + ".json";
+                if (!unchanged) writeFile(file, section.toJson().dump());
+                sections[key] = json::array({file});
+                keep.insert(file);
+                continue;
+            }
+
+            map<string, Run> old_runs;
+            if (before && !unchanged && before->isRecords()) {
+                for (auto& run : runsOf(before->records, partition)) old_runs.emplace(run.file, run);
+            }
+
+            json names = json::array();
+            const RecordList& records = section.records;
+            for (const auto& run : runsOf(records, partition)) {
+                names.push_back(run.file);
+                keep.insert(run.file);
+                if (unchanged) continue;
+
+                // Records shared with the previous snapshot compare by address
+                auto old = old_runs.find(run.file);
+                bool same = old != old_runs.end() &&
+                    old->second.end - old->second.begin == run.end - run.begin &&
+                    equal(records.iteratorAt(run.begin), records.iteratorAt(run.end),
+                          before->records.iteratorAt(old->second.begin),
+                          [](const json& x, const json& y) { return &x == &y || x == y; });
+                if (!same) writeFile(run.file, packRecords(records.toJson(run.begin, run.end)));
+            }
+            sections[key] = move(names);
+        }
+
+        json old_sections = manifest["sections"];
+        if (sections != old_sections) {
+            manifest["sections"] = sections;
+            writeFile("manifest.json", manifest.dump(4));
+            for (const auto& [key, names] : old_sections.items()) {
+                for (const auto& name : names) {
+                    if (!keep.count(name.get<string>())) {
+                        error_code ec;
+                        fs::remove(SHARD_DIR + "/" + name.get<string>(), ec);
+                    }
+                }
+            }
+        }
+    }
+};
+
+class TaskManager {
+public:
+    enum class ListOrder { Added, PriorityDeadline, Deadline, Created };
+
+private:
+    // Worker pool shared by shard mounts, sorts and index builds; declared
+    // first so it outlives everything that submits work to it
+    TaskExecutor executor;
+
+    // Current snapshot, swapped atomically; writers serialize on writerMutex
+    shared_ptr<const TaskSnapshot> current;
+    timed_mutex writerMutex;
+
+    // Background persistence of published snapshots
+    thread persister;
+    mutex persistMutex;
+    condition_variable persistCv;
+    uint64_t persistedVersion = 0;
+    bool stopPersister = false;
+
+    // Sharded layout, when enabled. Otherwise the shared file is rewritten on
+    // every change or, with logPatches, changes go to the patch log and are
+    // folded into it every PATCH_LOG_MAX_ENTRIES and on exit
+    unique_ptr<ShardedStore> shards;
+    bool logPatches = false;
+    mutex tasksFileMutex;                       // held while writing the shared file or the patch log
+    PatchLog patchLog{PATCH_LOG_FILE};          // guarded by tasksFileMutex
+    uint32_t canonicalCrc = 0;                  // CRC32C of the shared file as last read or written (tasksFileMutex)
+    shared_ptr<const TaskSnapshot> patchBase;   // content of the shared file (atomic_load/store)
+    shared_ptr<const TaskSnapshot> rebase;      // reloaded snapshot the patch log must restart from
+    uint32_t rebaseCrc = 0;
+    uint64_t sharedFileVersion = 0;             // sharded: version reloaded from the shared file, not re-exported
+
+    // Live reload state shared with the watcher thread
+    mutex reloadMutex;
+    optional<json> pendingReload;
+    uint32_t pendingReloadCrc = 0;
+    atomic<bool> reloadPending{false};
+    fs::file_time_type lastSavedWriteTime;
+    uintmax_t lastSavedSize = 0;
+    DatabaseWatcher watcher{[this] { onDatabaseChanged(); }};
+
+    // Deadline reminders fired on the scheduler thread, printed by the menu loop
+    mutex noticesMutex;
+    vector<string> notices;
+    ReminderScheduler reminders{[this](const ReminderScheduler::Reminder& reminder) { queueReminder(reminder); }};
+
+    // Undo/redo of task edits and the dashboard counters (guarded by writerMutex)
+    UndoHistory undoHistory;
+    TaskStats stats;
+
+    // Query indexes keyed by section, rebuilt when the section version changes (menu thread only)
+    map<string, pair<RecordList, shared_ptr<const task_query::TaskIndex>>> queryIndexes;
+
+    // Reusable page buffer for list output and the input reader (menu thread only)
+    ConsoleBuffer console;
+    LineReader input;
+
+    // Older activity history, rolled out of the live file in fixed-size segments
+    SegmentArchive historyArchive{"history"};
+
+    // Completed tasks older than COMPLETED_ARCHIVE_AFTER_DAYS, one shard per move;
+    // after a check finds too few, tiering waits for the cutoff day to move (writer)
+    SegmentArchive completedArchive{"completed"};
+    optional<TaskDate> tierDeferredAt;
+
+    /**
+     * Load existing tasks file or create new one if doesn't exist
+     */
+    json loadOrInitTasks() {
+        if (!fs::exists(DATA_DIR)) {
+            fs::create_directory(DATA_DIR);
+        }
+
+        if (!fs::exists(TASKS_FILE)) {
+            json initial_data = initialData();
+            saveTasks(*makeSnapshot(json(initial_data)));
+            return initial_data;
+        }
+
+        ifstream file(TASKS_FILE);
+        string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        file.close();
+
+        // If the sidecar describes this very file, its CRC must match too;
+        // otherwise the file was written by another version and is trusted as is
+        canonicalCrc = Crc32c::compute(content.data(), content.size());
+        optional<json> checksums = readChecksums();
+        bool described = checksums && describesTasksFile(*checksums);
+        bool intact = !described || (*checksums)["crc32c"] == canonicalCrc;
+        if (intact) {
+            try {
+                json data = parseDocument(content, executor);
+                if (validateData(data)) return data;
+            }
+            catch (const json::exception&) {
+                // Fall through to salvage
+            }
+        }
+        return salvageTasks(content, described ? &*checksums : nullptr);
+    }
+
+    /**
+     * Initial document for an empty database
+     */
+    static json initialData() {
+        return {
+            {"metadata", {
+                {"signature", SIGNATURE},
+                {"language", LANGUAGE},
+                {"last_modified", getCurrentTimestamp()},
+                {"author", AUTHOR}
+            }},
+            {"open_tasks", json::array()},
+            {"completed_tasks", json::array()},
+            {"activity_history", json::array()}
+        };
+    }
+
+    /**
+     * Rebuild a damaged tasks file from whatever records are still readable.
+     * Every version writes one record per indented block, so each record is
+     * cut out by its indentation and parsed on its own; with checksums for
+     * this file, records whose CRC32C is not on record are dropped as well.
+     * The damaged file is kept next to the database before it is replaced.
+     */
+    json salvageTasks(const string& content, const json* checksums) {
+        string stamp = getCurrentTimestamp();
+        replace(stamp.begin(), stamp.end(), ':', '-');
+        string backup = TASKS_FILE + ".corrupt-" + stamp;
+        error_code ec;
+        fs::copy_file(TASKS_FILE, backup, fs::copy_options::overwrite_existing, ec);
+
+        json data = initialData();
+        size_t recovered = 0;
+        size_t dropped = 0;
+
+        // Lines as {indentation, offset of first non-space character}
+        vector<pair<size_t, size_t>> lines;
+        for (size_t begin = 0; begin < content.size(); ) {
+            size_t end = content.find('\n', begin);
+            if (end == string::npos) end = content.size();
+            size_t first = content.find_first_not_of(' ', begin);
+            if (first < end) lines.emplace_back(first - begin, first);
+            begin = end + 1;
+        }
+
+        auto parseSpan = [&](size_t from, size_t to) -> optional<json> {
+            try {
+                return json::parse(content.begin() + from, content.begin() + to);
+            }
+            catch (const json::exception&) {
+                return nullopt;
+            }
+        };
+
+        for (auto& [key, value] : data.items()) {
+            string marker = json(key).dump() + ": ";
+            size_t line = 0;
+            while (line < lines.size() && content.compare(lines[line].second, marker.size(), marker) != 0) line++;
+            if (line == lines.size()) continue;
+            size_t keyIndent = lines[line].first;
+            size_t open = lines[line].second + marker.size();
+
+            if (key == "metadata") {
+                for (size_t next = line + 1; next < lines.size() && lines[next].first >= keyIndent; ++next) {
+                    if (lines[next].first == keyIndent && content[lines[next].second] == '}') {
+                        auto metadata = parseSpan(open, lines[next].second + 1);
+                        if (metadata && metadata->is_object()) value.update(*metadata);
+                        break;
+                    }
+                }
+                continue;
+            }
+
+            set<uint32_t> known;
+            if (checksums && checksums->contains("records") && (*checksums)["records"].contains(key)) {
+                for (const auto& crc : (*checksums)["records"][key]) known.insert(crc.get<uint32_t>());
+            }
+
+            size_t recordIndent = 0;
+            size_t start = string::npos;
+            for (size_t next = line + 1; next < lines.size() && lines[next].first > keyIndent; ++next) {
+                auto [indent, offset] = lines[next];
+                if (recordIndent == 0 && content[offset] == '{') recordIndent = indent;
+                if (indent != recordIndent) continue;
+
+                if (content[offset] == '{') {
+                    if (start != string::npos) dropped++;  // previous record never closed
+                    start = offset;
+                }
+                else if (content[offset] == '}' && start != string::npos) {
+                    auto record = parseSpan(start, offset + 1);
+                    bool verified = !checksums || known.count(Crc32c::compute(content.data() + start, offset + 1 - start));
+                    if (record && record->is_object() && verified) {
+                        value.push_back(move(*record));
+                        recovered++;
+                    }
+                    else {
+                        dropped++;
+                    }
+                    start = string::npos;
+                }
+            }
+            if (start != string::npos) dropped++;
+        }
+
+        cout << "\nWarning: the tasks file was damaged. Recovered " << recovered
+             << " record(s), dropped " << dropped << " damaged record(s).\n";
+        if (!ec) cout << "The damaged file was kept as " << backup << "\n";
+
+        saveTasks(*makeSnapshot(json(data)));
+        return data;
+    }
+
+    /**
+     * Validate the JSON data structure
+     */
+    bool validateData(const json& data) {
+        vector<string> required_keys = {"metadata", "open_tasks", "completed_tasks", "activity_history"};
+        for (const auto& key : required_keys) {
+            if (!data.contains(key)) return false;
+        }
+        for (const char* key : {"open_tasks", "completed_tasks", "activity_history"}) {
+            if (!data[key].is_array()) return false;
+        }
+
+        vector<string> metadata_keys = {"signature", "language", "last_modified", "author"};
+        for (const auto& key : metadata_keys) {
+            if (!data["metadata"].contains(key)) return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Split a loaded document into the sections of a new snapshot
+     */
+    static shared_ptr<TaskSnapshot> makeSnapshot(json&& data) {
+        auto snapshot = make_shared<TaskSnapshot>();
+        for (auto& [key, value] : data.items()) snapshot->sections[key] = TaskSnapshot::Section::of(move(value));
+        return snapshot;
+    }
+
+    /**
+     * Current snapshot; safe to iterate without locks
+     */
+    shared_ptr<const TaskSnapshot> snapshot() const {
+        return atomic_load(&current);
+    }
+
+    /**
+     * Record list of the next snapshot for the writer to modify; edits copy
+     * only the chunks they touch, and records are replaced, never changed
+     */
+    static RecordList& editRecords(TaskSnapshot& next, const string& key) {
+        return next.sections.at(key).records;
+    }
+
+    /**
+     * Copy of the next snapshot's metadata for the writer to modify
+     */
+    static json& editMetadata(TaskSnapshot& next) {
+        auto& value = next.sections.at("metadata").value;
+        auto copy = make_shared<json>(*value);
+        json& metadata = *copy;
+        value = move(copy);
+        return metadata;
+    }
+
+    /**
+     * Publish the next snapshot and hand it to the persistence thread (caller
+     * holds writerMutex). Local edits are stamped; a reloaded snapshot is not,
+     * and whatever it shares with the new patch base is not written again.
+     */
+    void publish(shared_ptr<TaskSnapshot> next, bool stamp = true) {
+        next->version = snapshot()->version + 1;
+        if (stamp) {
+            json& metadata = editMetadata(*next);
+            metadata["last_modified"] = getCurrentTimestamp();
+            metadata["language"] = LANGUAGE;
+            metadata["stats"] = stats.toJson(metadata["last_modified"]);
+        }
+
+        atomic_store(&current, shared_ptr<const TaskSnapshot>(move(next)));
+        {
+            // Orders the store before the persistence thread's next check
+            lock_guard<mutex> lock(persistMutex);
+        }
+        persistCv.notify_all();
+    }
+
+    /**
+     * Persistence thread: write the newest snapshot whenever one is published
+     * persisted is the snapshot already on disk, taken before the thread starts.
+     * With shards, the shared file is exported SHARED_EXPORT_DELAY_MS after the
+     * first save it misses, and before the thread stops.
+     */
+    void persistLoop(shared_ptr<const TaskSnapshot> persisted) {
+        using clock = chrono::steady_clock;
+        const auto never = clock::time_point::max();
+        auto exportDue = never;  // sharded: when the shared file is next exported
+        unique_lock<mutex> lock(persistMutex);
+        while (true) {
+            persistCv.wait_until(lock, exportDue, [this] {
+                return stopPersister || rebase || snapshot()->version > persistedVersion;
+            });
+
+            if (rebase) {
+                // The shared file was replaced by a reload: it is the new patch base
+                persisted = move(rebase);
+                rebase.reset();
+                lock_guard<mutex> fileLock(tasksFileMutex);
+                if (logPatches) patchLog.reset(rebaseCrc);
+                canonicalCrc = rebaseCrc;
+            }
+
+            auto latest = snapshot();
+            if (latest->version > persistedVersion) {
+                bool exported = latest->version == sharedFileVersion;
+                lock.unlock();
+                {
+                    lock_guard<mutex> fileLock(tasksFileMutex);
+                    if (shards) shards->save(persisted.get(), *latest);
+                    else persistChange(*persisted, latest);
+                }
+                persisted = latest;
+                lock.lock();
+                persistedVersion = max(persistedVersion, latest->version);
+                if (shards && exported) exportDue = never;
+                else if (shards && exportDue == never) exportDue = clock::now() + chrono::milliseconds(SHARED_EXPORT_DELAY_MS);
+                persistCv.notify_all();
+            }
+            else if (exportDue != never && (stopPersister || clock::now() >= exportDue)) {
+                exportDue = never;
+                lock.unlock();
+                {
+                    lock_guard<mutex> fileLock(tasksFileMutex);
+                    exportSharedFile(persisted);
+                }
+                lock.lock();
+            }
+            else if (stopPersister) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * Block until every published snapshot has been written, or the deadline passes
+     */
+    bool flush(chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max()) {
+        unique_lock<mutex> lock(persistMutex);
+        uint64_t target = snapshot()->version;
+        return persistCv.wait_until(lock, deadline, [&] { return persistedVersion >= target; });
+    }
+
+    /**
+     * Persist the change between two snapshots (caller holds tasksFileMutex):
+     * rewrite the shared file, or with logPatches log it as one RFC 6902
+     * patch and fold everything into the file once the log holds
+     * PATCH_LOG_MAX_ENTRIES patches. Every replace and remove is preceded by
+     * a test of the old value, so replay fails on a file it does not fit.
+     */
+    void persistChange(const TaskSnapshot& before, shared_ptr<const TaskSnapshot> after) {
+        if (!logPatches || patchLog.size() >= PATCH_LOG_MAX_ENTRIES || !patchLog.isOpen()) {
+            foldPatchLog(move(after));
+            return;
+        }
+
+        json patch = json::array();
+        for (const auto& [key, section] : after->sections) {
+            auto it = before.sections.find(key);
+            if (it == before.sections.end()) {
+                patch.push_back({{"op", "add"}, {"path", "/" + key}, {"value", section.toJson()}});
+            }
+            else if (it->second.sameAs(section)) {
+                continue;
+            }
+            else if (section.isRecords() && it->second.isRecords()) {
+                for (const auto& change : diffRecords(key, it->second.records, section.records)) {
+                    string path = "/" + key + "/" + to_string(change.index);
+                    if (change.before) patch.push_back({{"op", "test"}, {"path", path}, {"value", *change.before}});
+                    if (!change.after) patch.push_back({{"op", "remove"}, {"path", path}});
+                    else patch.push_back({{"op", change.before ? "replace" : "add"}, {"path", path}, {"value", *change.after}});
+                }
+            }
+            else {
+                json old = it->second.toJson();
+                for (auto& operation : json::diff(old, section.toJson(), "/" + key)) {
+                    if (operation["op"] != "add") {
+                        json::json_pointer target(operation["path"].get<string>().substr(key.size() + 1));
+                        patch.push_back({{"op", "test"}, {"path", operation["path"]}, {"value", old.at(target)}});
+                    }
+                    patch.push_back(move(operation));
+                }
+            }
+        }
+        if (!patch.empty()) patchLog.append(patch);
+    }
+
+    /**
+     * Sharded layout: write the shards' content to the shared file for the
+     * other versions; it becomes the base for carrying over changes on reload
+     * (caller holds tasksFileMutex)
+     */
+    void exportSharedFile(shared_ptr<const TaskSnapshot> data) {
+        saveTasks(*data);
+        shards->recordExport();
+        atomic_store(&patchBase, move(data));
+    }
+
+    /**
+     * Rewrite the shared file from a snapshot, which becomes the patch base,
+     * and start an empty patch log if one is kept (caller holds tasksFileMutex)
+     */
+    void foldPatchLog(shared_ptr<const TaskSnapshot> data) {
+        saveTasks(*data);
+        if (logPatches) patchLog.reset(canonicalCrc);
+        atomic_store(&patchBase, move(data));
+    }
+
+    /**
+     * Save a snapshot to file (once threads run, caller holds tasksFileMutex)
+     */
+    void saveTasks(const TaskSnapshot& data) {
+        string content;
+        json records;
+        writeSnapshot(content, data, &records);
+        {
+            // Written aside and renamed over, so an interrupted save never leaves
+            // the shared file truncated
+            ofstream file(TASKS_FILE + ".tmp", ios::trunc);
+            file << content;
+            file.close();
+            error_code ec;
+            if (file) fs::rename(TASKS_FILE + ".tmp", TASKS_FILE, ec);
+            if (!file || ec) {
+                fs::remove(TASKS_FILE + ".tmp", ec);
+                cout << "\nWarning: could not save " << TASKS_FILE << "; the previous version is kept.\n";
+                return;
+            }
+        }
+        canonicalCrc = Crc32c::compute(content.data(), content.size());
+        rememberOwnWrite();
+        writeChecksums(move(records));
+    }
+
+    /**
+     * Write the checksum sidecar for the file just saved: whole-file and
+     * per-record CRC32C plus the size and write time that identify the file
+     */
+    void writeChecksums(json records) {
+        error_code ec;
+        auto size = fs::file_size(TASKS_FILE, ec);
+        auto writeTime = fs::last_write_time(TASKS_FILE, ec);
+        if (ec) return;
+        json checksums = {
+            {"size", size},
+            {"write_time", static_cast<int64_t>(writeTime.time_since_epoch().count())},
+            {"crc32c", canonicalCrc},
+            {"records", move(records)}
+        };
+        ofstream file(CHECKSUM_FILE + ".tmp", ios::trunc);
+        file << checksums.dump();
+        file.close();
+        if (file) fs::rename(CHECKSUM_FILE + ".tmp", CHECKSUM_FILE, ec);
+    }
+
+    static optional<json> readChecksums() {
+        try {
+            ifstream file(CHECKSUM_FILE);
+            if (!file) return nullopt;
+            return json::parse(file);
+        }
+        catch (const json::exception&) {
+            return nullopt;
+        }
+    }
+
+    /**
+     * True if the sidecar was written for the tasks file as it is on disk now
+     */
+    static bool describesTasksFile(const json& checksums) {
+        error_code ec;
+        auto size = fs::file_size(TASKS_FILE, ec);
+        if (ec) return false;
+        auto writeTime = fs::last_write_time(TASKS_FILE, ec);
+        return !ec && checksums.value("size", uintmax_t(0)) == size &&
+               checksums.value("write_time", int64_t(0)) == static_cast<int64_t>(writeTime.time_since_epoch().count());
+    }
+
+    /**
+     * Record the size and write time of our own save so the watcher ignores it
+     */
+    void rememberOwnWrite() {
+        error_code ec;
+        auto writeTime = fs::last_write_time(TASKS_FILE, ec);
+        auto size = fs::file_size(TASKS_FILE, ec);
+        lock_guard<mutex> lock(reloadMutex);
+        lastSavedWriteTime = writeTime;
+        lastSavedSize = size;
+    }
+
+    /**
+     * Watcher callback: parse the externally modified file off the main thread
+     */
+    void onDatabaseChanged() {
+        error_code ec;
+        auto writeTime = fs::last_write_time(TASKS_FILE, ec);
+        if (ec) return;
+        auto size = fs::file_size(TASKS_FILE, ec);
+        if (ec) return;
+
+        {
+            lock_guard<mutex> lock(reloadMutex);
+            if (writeTime == lastSavedWriteTime && size == lastSavedSize) return;
+        }
+
+        try {
+            ifstream file(TASKS_FILE);
+            string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+            json data = parseDocument(content, executor);
+            if (!validateData(data)) return;
+
+            lock_guard<mutex> lock(reloadMutex);
+            lastSavedWriteTime = writeTime;
+            lastSavedSize = size;
+            pendingReload = move(data);
+            pendingReloadCrc = Crc32c::compute(content.data(), content.size());
+            reloadPending = true;
+        }
+        catch (...) {
+            // Partial write from another version; the next close event retries
+        }
+    }
+
+    /**
+     * Merge a reloaded file into memory, replacing only the sections that changed
+     */
+    void applyPendingReload() {
+        if (!reloadPending) return;
+
+        json fresh;
+        uint32_t freshCrc;
+        {
+            lock_guard<mutex> lock(reloadMutex);
+            if (!pendingReload) return;
+            fresh = move(*pendingReload);
+            freshCrc = pendingReloadCrc;
+            pendingReload.reset();
+            reloadPending = false;
+        }
+
+        lock_guard<timed_mutex> lock(writerMutex);
+        // Changes not in the shared file yet (still in the patch log, or not
+        // exported from the shards) were never seen by the other version;
+        // carry them over onto its file before adopting it
+        shared_ptr<TaskSnapshot> base = makeSnapshot(move(fresh));
+        TaskSnapshot merged = *base;
+        set<string> carried = carryOverPending(merged);
+        bool ours = !carried.empty();
+
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        int changed = 0;
+        for (const auto& [key, section] : merged.sections) {
+            auto it = next->sections.find(key);
+            if (it == next->sections.end() || it->second != section) {
+                next->sections[key] = section;
+                changed++;
+            }
+            // A section as the other version wrote it is shared with the base,
+            // so the persistence thread logs only the carried-over changes
+            if (!carried.count(key)) base->sections[key] = next->sections[key];
+        }
+        {
+            lock_guard<mutex> persistLock(persistMutex);
+            atomic_store(&patchBase, shared_ptr<const TaskSnapshot>(base));
+            if (!shards) {
+                // The patch log restarts from the new shared file; the shards
+                // keep being compared with what they hold
+                rebase = base;
+                rebaseCrc = freshCrc;
+            }
+        }
+        if (changed > 0 || ours) {
+            for (const char* key : {"open_tasks", "completed_tasks"}) {
+                if (next->sections.at(key).sameAs(snapshot()->sections.at(key))) continue;
+                countChanges(diffRecords(key, snapshot()->records(key), next->records(key)));
+            }
+            bool open_changed = !next->sections.at("open_tasks").sameAs(snapshot()->sections.at("open_tasks"));
+            if (shards && !ours) {
+                // Already in the shared file: only the shards are written
+                lock_guard<mutex> persistLock(persistMutex);
+                sharedFileVersion = snapshot()->version + 1;
+            }
+            publish(move(next), ours);
+            if (open_changed) scheduleAllReminders(snapshot()->records("open_tasks"));
+            if (changed > 0) cout << "\n[Tasks reloaded - file was updated by another version]\n";
+        }
+        persistCv.notify_all();
+    }
+
+    /**
+     * Re-apply the changes not yet folded into the shared file (patch base to
+     * current) onto a freshly reloaded file. Records are matched by value, so
+     * a record the other version changed or removed is left as it wrote it.
+     * Returns the sections a change was applied to.
+     */
+    set<string> carryOverPending(TaskSnapshot& fresh) {
+        auto base = atomic_load(&patchBase);
+        auto latest = snapshot();
+        set<string> applied;
+        for (const auto& [key, section] : latest->sections) {
+            auto it = base->sections.find(key);
+            auto target = fresh.sections.find(key);
+            if (it == base->sections.end() || it->second.sameAs(section) || !section.isRecords() ||
+                !it->second.isRecords() || target == fresh.sections.end() || !target->second.isRecords()) {
+                continue;
+            }
+            for (const auto& change : diffRecords(key, it->second.records, section.records)) {
+                if (applyRecordChange(target->second.records, change)) applied.insert(key);
+            }
+        }
+        return applied;
+    }
+
+    /**
+     * Keep the live history window bounded: once it holds two segments' worth,
+     * move the oldest HISTORY_SEGMENT_SIZE entries to the archive
+     * Returns true if anything was rolled (caller holds writerMutex)
+     */
+    bool rollHistory(RecordList& history) {
+        bool rolled = false;
+        while (history.size() >= 2 * HISTORY_SEGMENT_SIZE) {
+            historyArchive.append(history.toJson(0, HISTORY_SEGMENT_SIZE));
+            history.erasePrefix(HISTORY_SEGMENT_SIZE);
+            rolled = true;
+        }
+        return rolled;
+    }
+
+    /**
+     * True if a completed task finished before the archive cutoff day
+     */
+    static bool isArchivable(const json& task, TaskDate cutoff) {
+        auto it = task.find("completed_at");
+        TaskDate completed;
+        return it != task.end() && it->is_string() &&
+               TaskDate::parseIso(it->get_ref<const string&>(), completed) && completed < cutoff;
+    }
+
+    /**
+     * Move completed tasks older than COMPLETED_ARCHIVE_AFTER_DAYS into a new
+     * archive shard, keeping the order of both parts; waits until at least
+     * COMPLETED_SHARD_MIN_SIZE qualify so shards stay reasonably sized. A
+     * check that finds too few is not repeated before the cutoff day moves,
+     * so completions do not rescan the list while the oldest one has aged out.
+     * Returns true if anything was moved (caller holds writerMutex)
+     */
+    bool tierCompleted(RecordList& completed) {
+        TaskDate cutoff = today() + -COMPLETED_ARCHIVE_AFTER_DAYS;
+        if (tierDeferredAt && cutoff <= *tierDeferredAt) return false;
+        size_t old_count = 0;
+        for (const auto& task : completed) {
+            if (isArchivable(task, cutoff)) old_count++;
+        }
+        if (old_count < COMPLETED_SHARD_MIN_SIZE) {
+            tierDeferredAt = cutoff;
+            return false;
+        }
+
+        json archived = json::array();
+        RecordList live;
+        for (auto task = completed.begin(); task != completed.end(); ++task) {
+            if (isArchivable(*task, cutoff)) archived.push_back(*task);
+            else live.push_back(task.record());
+        }
+        completedArchive.append(archived);
+        completed = move(live);
+        return true;
+    }
+
+    /**
+     * Rows of a live section that are also in the newest segment of its
+     * archive. A segment is written before the live file that no longer holds
+     * its records is saved, so a run that stopped in between leaves them in
+     * both. History rolls off a prefix; completed tasks are tiered from
+     * anywhere in the list and are matched by value among the archivable ones.
+     */
+    static vector<size_t> archivedDuplicates(const SegmentArchive& archive, const RecordList& live, bool prefix) {
+        vector<size_t> rows;
+        size_t count = archive.segmentCount();
+        if (count == 0 || live.empty()) return rows;
+        try {
+            auto segment = archive.open(count - 1);
+            json archived = json::array();
+            for (size_t b = 0; b < segment.blockCount(); ++b) {
+                for (auto& record : segment.block(b)) archived.push_back(move(record));
+            }
+            if (prefix) {
+                if (archived.size() <= live.size() && equal(archived.begin(), archived.end(), live.begin())) {
+                    for (size_t row = 0; row < archived.size(); ++row) rows.push_back(row);
+                }
+                return rows;
+            }
+            TaskDate cutoff = today() + -COMPLETED_ARCHIVE_AFTER_DAYS;
+            size_t row = 0;
+            for (auto task = live.begin(); task != live.end(); ++task, ++row) {
+                if (isArchivable(*task, cutoff) && find(archived.begin(), archived.end(), *task) != archived.end()) {
+                    rows.push_back(row);
+                }
+            }
+        }
+        catch (const exception&) {
+            // A damaged segment is not trusted to drop anything
+            rows.clear();
+        }
+        return rows;
+    }
+
+    /**
+     * Remove the given ascending rows from a record list
+     */
+    static void eraseRows(RecordList& records, const vector<size_t>& rows) {
+        RecordList kept;
+        size_t next = 0;
+        size_t row = 0;
+        for (auto record = records.begin(); record != records.end(); ++record, ++row) {
+            if (next < rows.size() && rows[next] == row) next++;
+            else kept.push_back(record.record());
+        }
+        records = move(kept);
+    }
+
+    /**
+     * Drop records a stopped run left in both the live file and the archive,
+     * then roll history and completed tasks that grew past their live window
+     * while we were not running
+     */
+    void compactArchives() {
+        lock_guard<timed_mutex> lock(writerMutex);
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        bool changed = false;
+        for (auto [key, archive, prefix] : {make_tuple("activity_history", &historyArchive, true),
+                                            make_tuple("completed_tasks", &completedArchive, false)}) {
+            auto rows = archivedDuplicates(*archive, next->records(key), prefix);
+            if (rows.empty()) continue;
+            eraseRows(editRecords(*next, key), rows);
+            changed = true;
+        }
+        if (next->records("activity_history").size() >= 2 * HISTORY_SEGMENT_SIZE) {
+            changed |= rollHistory(editRecords(*next, "activity_history"));
+        }
+        if (next->records("completed_tasks").size() >= COMPLETED_SHARD_MIN_SIZE) {
+            changed |= tierCompleted(editRecords(*next, "completed_tasks"));
+        }
+        if (changed) publish(move(next));
+    }
+
+    /**
+     * Reminder callback: format the notice for the next menu redraw
+     */
+    void queueReminder(const ReminderScheduler::Reminder& reminder) {
+        string notice = "[Reminder] Task '" + reminder.name + "' " +
+            (reminder.overdue ? "is overdue (deadline " + reminder.deadline + ")"
+                              : "is due soon (deadline " + reminder.deadline + ")");
+        lock_guard<mutex> lock(noticesMutex);
+        notices.push_back(move(notice));
+    }
+
+    /**
+     * Print reminders that fired since the last menu redraw
+     */
+    void printNotices() {
+        vector<string> pending;
+        {
+            lock_guard<mutex> lock(noticesMutex);
+            pending.swap(notices);
+        }
+        for (const auto& notice : pending) cout << "\n" << notice;
+        if (!pending.empty()) cout << "\n";
+    }
+
+    /**
+     * Add program exit signature to activity history
+     * With a deadline, gives up on the signature or the flush once it passes
+     */
+    void addExitSignature(chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max()) {
+        string timestamp = getCurrentTimestamp();
+        {
+            unique_lock<timed_mutex> lock(writerMutex, deadline);
+            if (lock.owns_lock()) {
+                auto next = make_shared<TaskSnapshot>(*snapshot());
+                RecordList& history = editRecords(*next, "activity_history");
+                history.push_back(make_shared<const json>(json{
+                    {"program", "Task Manager"},
+                    {"language", LANGUAGE},
+                    {"timestamp", timestamp}
+                }));
+                rollHistory(history);
+                publish(move(next));
+            }
+        }
+        if (flush(deadline) && logPatches && !shards) {
+            // Fold the patch log so the other language versions stay in sync
+            lock_guard<mutex> lock(persistMutex);
+            lock_guard<mutex> fileLock(tasksFileMutex);
+            if (patchLog.size() > 0 || rebase) {
+                foldPatchLog(snapshot());
+                rebase.reset();
+            }
+        }
+    }
+
+    /**
+     * Get current timestamp in ISO format
+     */
+    static string getCurrentTimestamp() {
+        return TimestampService::now();
+    }
+
+    /**
+     * Validate date format and ensure it's not in the past
+     */
+    bool validateDate(const string& date) {
+        TaskDate deadline;
+        if (!TaskDate::parse(date, deadline)) return false;
+        return deadline.year() >= today().year();
+    }
+
+    /**
+     * Today's local date
+     */
+    static TaskDate today() {
+        return TimestampService::today();
+    }
+
+    /**
+     * Parsed deadline field of a task, if present and valid
+     */
+    static optional<TaskDate> deadlineOf(const json& task) {
+        auto it = task.find("deadline");
+        TaskDate date;
+        if (it == task.end() || !it->is_string() || !TaskDate::parse(it->get_ref<const string&>(), date)) return nullopt;
+        return date;
+    }
 
-// Global constants for file and program configuration
-const string DATA_DIR = "../data";
-const string TASKS_FILE = DATA_DIR + "/DB_task_manager.json";
-const string SIGNATURE = "TaskManager";
-const string LANGUAGE = "(CPP-CLI Version)";
-const string AUTHOR = "Hananel Sabag";
+    /**
+     * Recurrence rule of a repeating task, anchored at its deadline
+     */
+    static optional<RecurrenceRule> recurrenceOf(const json& task) {
+        auto it = task.find("recurrence");
+        if (it == task.end() || !it->is_object()) return nullopt;
+        auto frequency = RecurrenceRule::parseFrequency(it->value("frequency", ""));
+        auto anchor = deadlineOf(task);
+        if (!frequency || !anchor) return nullopt;
+        return RecurrenceRule(*frequency, *anchor);
+    }
 
-// Global pointer for signal handler
-class TaskManager;
-TaskManager* globalTaskManager = nullptr;
+    /**
+     * Deadline still to be met: the task deadline, or for a recurring task the
+     * first occurrence after the last completed one (expanded lazily)
+     */
+    static optional<TaskDate> pendingDeadline(const json& task) {
+        auto rule = recurrenceOf(task);
+        if (!rule) return deadlineOf(task);
 
-class TaskManager {
-private:
-    json tasks;
+        TaskDate done;
+        const json& recurrence = task["recurrence"];
+        auto through = recurrence.find("completed_through");
+        if (through != recurrence.end() && through->is_string() &&
+            TaskDate::parse(through->get_ref<const string&>(), done)) {
+            return rule->nextAfter(done);
+        }
+        return rule->getAnchor();
+    }
 
     /**
-     * Load existing tasks file or create new one if doesn't exist
+     * 32-bit sort key of an open task; missing values sort last
      */
-    json loadOrInitTasks() {
-        if (!fs::exists(DATA_DIR)) {
-            fs::create_directory(DATA_DIR);
+    static uint32_t sortKey(const json& task, ListOrder order) {
+        if (order == ListOrder::Created) {
+            auto created = localSeconds(task, "created_at");
+            return created ? static_cast<uint32_t>(clamp<int64_t>(*created, 0, UINT32_MAX - 1)) : UINT32_MAX;
         }
+        // Day numbers biased to unsigned; 30 bits leave room for the priority
+        auto deadline = pendingDeadline(task);
+        uint32_t day = deadline ? static_cast<uint32_t>(clamp<int64_t>(deadline->dayNumber() + (1 << 29), 0, (1 << 30) - 2))
+                                : (1u << 30) - 1;
+        if (order == ListOrder::Deadline) return day;
 
-        if (!fs::exists(TASKS_FILE)) {
-            json initial_data = {
-                {"metadata", {
-                    {"signature", SIGNATURE},
-                    {"language", LANGUAGE},
-                    {"last_modified", getCurrentTimestamp()},
-                    {"author", AUTHOR}
-                }},
-                {"open_tasks", json::array()},
-                {"completed_tasks", json::array()},
-                {"activity_history", json::array()}
-            };
-            saveTasks(initial_data);
-            return initial_data;
+        uint32_t rank = 0;  // index in TaskStats::PRIORITIES, high is 3
+        auto priority = task.find("priority");
+        for (uint32_t i = 1; priority != task.end() && i < TaskStats::PRIORITIES.size(); ++i) {
+            if (*priority == TaskStats::PRIORITIES[i]) rank = i;
         }
+        return (3 - rank) << 30 | day;
+    }
 
-        try {
-            ifstream file(TASKS_FILE);
-            json data = json::parse(file);
-            if (validateData(data)) {
-                return data;
+    /**
+     * Rows of tasks in the given order: the sort key goes above the row in one
+     * 64-bit integer, so keys are built and sorted in parallel without ever
+     * comparing json values
+     */
+    static vector<uint32_t> sortedRows(const RecordList& tasks, ListOrder order, TaskExecutor& executor) {
+        vector<uint64_t> keys(tasks.size());
+        executor.parallelFor(keys.size(), [&](size_t begin, size_t end) {
+            auto task = tasks.iteratorAt(begin);
+            for (size_t row = begin; row < end; ++row, ++task) keys[row] = static_cast<uint64_t>(sortKey(*task, order)) << 32 | row;
+        });
+        parallel_sort::sort(keys, executor);
+        vector<uint32_t> rows(keys.size());
+        for (size_t k = 0; k < keys.size(); ++k) rows[k] = static_cast<uint32_t>(keys[k]);
+        return rows;
+    }
+
+    /**
+     * True if the task's pending deadline is before the given day
+     */
+    static bool isOverdue(const json& task, TaskDate day) {
+        auto deadline = pendingDeadline(task);
+        return deadline && *deadline < day;
+    }
+
+    /**
+     * Schedule reminders for the pending deadline of one task
+     */
+    void scheduleReminder(const json& task) {
+        if (auto deadline = pendingDeadline(task)) reminders.schedule(task, *deadline);
+    }
+
+    /**
+     * Replace all reminders with those of the given open tasks
+     */
+    void scheduleAllReminders(const RecordList& open_tasks) {
+        reminders.clear();
+        for (const auto& task : open_tasks) scheduleReminder(task);
+    }
+
+    /**
+     * Record the task changes between two snapshots as one undo step and
+     * count them in the dashboard counters (writer)
+     */
+    void recordEdit(string label, const TaskSnapshot& before, const TaskSnapshot& after) {
+        UndoHistory::Entry entry{move(label), {}};
+        for (const char* key : {"open_tasks", "completed_tasks"}) {
+            if (before.sections.at(key).sameAs(after.sections.at(key))) continue;
+            for (auto& change : diffRecords(key, before.records(key), after.records(key))) entry.changes.push_back(move(change));
+        }
+        countChanges(entry.changes);
+        if (!entry.changes.empty()) undoHistory.record(move(entry));
+    }
+
+    /**
+     * Apply record changes to the dashboard counters (writer)
+     */
+    void countChanges(const vector<RecordChange>& changes) {
+        for (const auto& change : changes) {
+            if (change.section == "open_tasks") {
+                if (change.before) stats.countOpen(*change.before, pendingDeadline(*change.before), -1);
+                if (change.after) stats.countOpen(*change.after, pendingDeadline(*change.after), 1);
+            }
+            else if (change.section == "completed_tasks") {
+                if (change.before) stats.countCompleted(*change.before, -1);
+                if (change.after) stats.countCompleted(*change.after, 1);
             }
-            throw runtime_error("Invalid data structure");
         }
-        catch (...) {
-            return loadOrInitTasks();
+    }
+
+    /**
+     * Counters stored with the snapshot, or recounted from the live records
+     * and the completed archive when they are missing or stale
+     */
+    TaskStats loadStats(const TaskSnapshot& view) {
+        if (auto stored = TaskStats::fromMetadata(view.metadata(), view.records("open_tasks").size())) return *stored;
+
+        TaskStats counted;
+        for (const auto& task : view.records("open_tasks")) counted.countOpen(task, pendingDeadline(task), 1);
+        const RecordList& completed = view.records("completed_tasks");
+        auto archived = archivedDuplicates(completedArchive, completed, false);  // counted from the archive
+        size_t row = 0, next = 0;
+        for (auto task = completed.begin(); task != completed.end(); ++task, ++row) {
+            if (next < archived.size() && archived[next] == row) next++;
+            else counted.countCompleted(*task, 1);
+        }
+        for (size_t i = 0; i < completedArchive.segmentCount(); ++i) {
+            try {
+                auto segment = completedArchive.open(i);
+                for (size_t b = 0; b < segment.blockCount(); ++b) {
+                    for (const auto& task : segment.block(b)) counted.countCompleted(task, 1);
+                }
+            }
+            catch (const exception&) {
+                // Damaged archive data is left out of the counts
+            }
         }
+        return counted;
     }
 
     /**
-     * Validate the JSON data structure
+     * Apply undo/redo changes to a new snapshot and publish it (writer)
+     * Nothing is published if a record a change needs is gone
      */
-    bool validateData(const json& data) {
-        vector<string> required_keys = {"metadata", "open_tasks", "completed_tasks", "activity_history"};
-        for (const auto& key : required_keys) {
-            if (!data.contains(key)) return false;
+    bool applyChanges(const vector<RecordChange>& changes) {
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        for (const auto& change : changes) {
+            if (!applyRecordChange(editRecords(*next, change.section), change)) return false;
         }
+        countChanges(changes);
+        publish(move(next));
+        scheduleAllReminders(snapshot()->records("open_tasks"));
+        return true;
+    }
 
-        vector<string> metadata_keys = {"signature", "language", "last_modified", "author"};
-        for (const auto& key : metadata_keys) {
-            if (!data["metadata"].contains(key)) return false;
+public:
+    /**
+     * Initialize task manager; with sharded_layout (or an existing manifest)
+     * the task state is kept in SHARD_DIR instead of the shared file, and
+     * with patch_log changes are logged instead of rewriting the shared file.
+     * threads sizes the worker pool (0 = one per hardware thread).
+     */
+    explicit TaskManager(bool sharded_layout = false, size_t threads = 0, bool patch_log = false)
+        : executor(threads), logPatches(patch_log) {
+        if (sharded_layout || ShardedStore::exists()) {
+            shards = make_unique<ShardedStore>();
+        }
+        if (shards && ShardedStore::exists() && shards->isSharedFileCurrent()) {
+            set<string> damaged;
+            json data = shards->mount(executor, damaged);
+            if (!damaged.empty()) {
+                // The shared file is our last export and may be older than the
+                // healthy shards: take only the damaged sections from it
+                string names;
+                for (const auto& section : damaged) names += (names.empty() ? "" : ", ") + section;
+                cout << "\nWarning: could not read the shards of " << names << "; those are taken from the tasks file"
+                     << " and the old shards are kept in " << SHARD_DIR << ".previous.\n";
+                json exported = loadOrInitTasks();
+                for (const auto& section : damaged) {
+                    if (exported.contains(section)) data[section] = move(exported[section]);
+                }
+            }
+            if (validateData(data)) {
+                current = makeSnapshot(move(data));
+                if (!damaged.empty()) {
+                    shards->setAside();
+                    shards->save(nullptr, *current);
+                    saveTasks(*current);
+                    shards->recordExport();
+                }
+                else if (shards->changedSinceExport()) {
+                    // The last run stopped before exporting its latest changes
+                    saveTasks(*current);
+                    shards->recordExport();
+                }
+            }
+            else {
+                cout << "\nWarning: the shards do not hold a complete task list; using the tasks file"
+                     << " (the old shards are kept in " << SHARD_DIR << ".previous).\n";
+            }
+        }
+        if (!current) {
+            json data = loadOrInitTasks();
+            size_t replayed = patchLog.replay(data, canonicalCrc);
+            if (!validateData(data)) throw runtime_error("Invalid data structure after patch replay");
+            current = makeSnapshot(move(data));
+            if (shards) {
+                // First run or the shared file was changed by another version: reshard,
+                // keeping the shards being replaced
+                if (replayed > 0) saveTasks(*current);
+                patchLog.discard();
+                if (ShardedStore::exists()) shards->setAside();
+                shards->save(nullptr, *current);
+                shards->recordExport();
+            }
+            else if (replayed > 0) {
+                // Changes left by an interrupted run: bring the shared file up to date
+                foldPatchLog(current);
+            }
+            if (!logPatches) patchLog.discard();
         }
+        stats = loadStats(*current);
+        patchBase = current;
+        rememberOwnWrite();
+        persister = thread(&TaskManager::persistLoop, this, snapshot());
+        watcher.start();
+        compactArchives();
+        scheduleAllReminders(snapshot()->records("open_tasks"));
+        reminders.start();
+    }
 
-        return true;
+    /**
+     * Stop background threads after writing pending snapshots
+     */
+    ~TaskManager() {
+        watcher.stop();
+        reminders.stop();
+        {
+            lock_guard<mutex> lock(persistMutex);
+            stopPersister = true;
+        }
+        persistCv.notify_all();
+        if (persister.joinable()) persister.join();
     }
 
     /**
-     * Save tasks to file and update metadata
+     * Handle program exit with signature; the menu then returns and the
+     * destructor stops and joins the background threads
      */
-    void saveTasks(json& data) {
-        string timestamp = getCurrentTimestamp();
-        data["metadata"]["last_modified"] = timestamp;
-        data["metadata"]["language"] = LANGUAGE;
-        
-        ofstream file(TASKS_FILE, ios::trunc);
-        file << setw(4) << data;
-        file.close();
+    void exitProgram() {
+        addExitSignature();
+        cout << "\nGoodbye! Made by " << AUTHOR << " " << LANGUAGE << "." << endl;
     }
 
     /**
-     * Add program exit signature to activity history
+     * Handle a termination signal; runs on the menu thread once its input
+     * wait sees the signal, and waits at most SHUTDOWN_FLUSH_MS for the
+     * signature to be written. A save still running finishes in the destructor.
      */
-    void addExitSignature() {
-        string timestamp = getCurrentTimestamp();
-        tasks["activity_history"].push_back({
-            {"program", "Task Manager"},
-            {"language", LANGUAGE},
-            {"timestamp", timestamp}
-        });
-        
-        ofstream file(TASKS_FILE, ios::trunc);
-        file << setw(4) << tasks;
-        file.close();
+    void exitOnSignal() {
+        cout << "\nReceived interrupt signal. Cleaning up...\n";
+        addExitSignature(chrono::steady_clock::now() + chrono::milliseconds(SHUTDOWN_FLUSH_MS));
+        cout << "\nGoodbye! Made by " << AUTHOR << " " << LANGUAGE << "." << endl;
     }
 
     /**
-     * Get current timestamp in ISO format
+     * Copy of the dashboard counters
      */
-    string getCurrentTimestamp() {
-        auto now = chrono::system_clock::now();
-        auto now_c = chrono::system_clock::to_time_t(now);
-        char buffer[30];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", localtime(&now_c));
-        return string(buffer);
+    TaskStats statistics() {
+        lock_guard<timed_mutex> lock(writerMutex);
+        return stats;
     }
 
     /**
-     * Validate date format and ensure it's not in the past
+     * Number of open tasks (reader)
      */
-    bool validateDate(const string& date) {
-        if (date.length() != 10) return false;
-        if (date[2] != '-' || date[5] != '-') return false;
+    size_t openTaskCount() const {
+        return snapshot()->records("open_tasks").size();
+    }
 
-        try {
-            int day = stoi(date.substr(0, 2));
-            int month = stoi(date.substr(3, 2));
-            int year = stoi(date.substr(6, 4));
+    /**
+     * Append a new open task (writer)
+     * A recurring task stores only its rule; the deadline is the first occurrence
+     */
+    json addTaskRecord(const string& name, const string& priority, const string& deadline,
+                       optional<RecurrenceRule::Frequency> repeat = nullopt) {
+        json new_task = {
+            {"name", name},
+            {"priority", priority},
+            {"deadline", deadline},
+            {"created_at", getCurrentTimestamp()}
+        };
+        if (repeat) {
+            new_task["recurrence"] = {{"frequency", RecurrenceRule::frequencyName(*repeat)}};
+        }
 
-            if (month < 1 || month > 12) return false;
-            if (day < 1 || day > 31) return false;
+        lock_guard<timed_mutex> lock(writerMutex);
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        editRecords(*next, "open_tasks").push_back(make_shared<const json>(new_task));
+        recordEdit("add '" + name + "'", *snapshot(), *next);
+        publish(move(next));
+        scheduleReminder(new_task);
+        return new_task;
+    }
 
-            auto now = chrono::system_clock::now();
-            auto now_c = chrono::system_clock::to_time_t(now);
-            auto current_year = localtime(&now_c)->tm_year + 1900;
+    /**
+     * Move the open task at index to completed tasks (writer)
+     * Returns the completed record, or nothing if the index is out of range
+     */
+    optional<json> completeTask(size_t index) {
+        string timestamp = getCurrentTimestamp();
+        lock_guard<timed_mutex> lock(writerMutex);
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        RecordList& open_tasks = editRecords(*next, "open_tasks");
+        if (index >= open_tasks.size()) return nullopt;
 
-            if (year < current_year) return false;
+        const json& task = open_tasks[index];
+        json completed_task = task;
+        completed_task["completed_at"] = timestamp;
+        completed_task["status"] = "completed";
+        reminders.cancel(task);
 
-            return true;
+        if (recurrenceOf(task)) {
+            // Record only this occurrence; the rule stays open for the next one
+            string occurrence = pendingDeadline(task)->toString();
+            completed_task.erase("recurrence");
+            completed_task["deadline"] = occurrence;
+            json rescheduled = task;
+            rescheduled["recurrence"]["completed_through"] = occurrence;
+            scheduleReminder(rescheduled);
+            open_tasks.set(index, make_shared<const json>(move(rescheduled)));
         }
-        catch (...) {
-            return false;
+        else {
+            open_tasks.erase(index);
         }
+        RecordList& completed_tasks = editRecords(*next, "completed_tasks");
+        completed_tasks.push_back(make_shared<const json>(completed_task));
+        // Recorded before tiering: records moved to the archive are not part of the edit
+        recordEdit("completion of '" + completed_task["name"].get<string>() + "'", *snapshot(), *next);
+        if (isArchivable(completed_tasks.front(), today() + -COMPLETED_ARCHIVE_AFTER_DAYS)) {
+            tierCompleted(completed_tasks);
+        }
+        publish(move(next));
+        return completed_task;
     }
 
-public:
     /**
-     * Initialize task manager and set up signal handling
+     * Remove the open task at index (writer)
+     * Returns the removed task name, or nothing if the index is out of range
      */
-    TaskManager() {
-        tasks = loadOrInitTasks();
-        globalTaskManager = this;
+    optional<string> removeTask(size_t index) {
+        lock_guard<timed_mutex> lock(writerMutex);
+        auto next = make_shared<TaskSnapshot>(*snapshot());
+        RecordList& open_tasks = editRecords(*next, "open_tasks");
+        if (index >= open_tasks.size()) return nullopt;
+
+        string task_name = open_tasks[index].at("name");
+        reminders.cancel(open_tasks[index]);
+        open_tasks.erase(index);
+        recordEdit("deletion of '" + task_name + "'", *snapshot(), *next);
+        publish(move(next));
+        return task_name;
     }
 
     /**
-     * Cleanup and reset global pointer
+     * Revert the most recent task edit (writer)
+     * Returns its label, or nothing if there is nothing to undo; throws if the
+     * records it touched have since been changed elsewhere
      */
-    ~TaskManager() {
-        globalTaskManager = nullptr;
+    optional<string> undoLast() {
+        lock_guard<timed_mutex> lock(writerMutex);
+        const auto* entry = undoHistory.nextUndo();
+        if (!entry) return nullopt;
+        if (!applyChanges(UndoHistory::inverse(*entry))) {
+            throw runtime_error("the tasks touched by the " + entry->label + " have changed since");
+        }
+        string label = entry->label;
+        undoHistory.undone();
+        return label;
     }
 
     /**
-     * Handle program exit with signature
+     * Re-apply the most recently undone edit (writer)
      */
-    void exitProgram() {
-        addExitSignature();
-        cout << "\nGoodbye! Made by " << AUTHOR << " " << LANGUAGE << "." << endl;
-        exit(0);
+    optional<string> redoLast() {
+        lock_guard<timed_mutex> lock(writerMutex);
+        const auto* entry = undoHistory.nextRedo();
+        if (!entry) return nullopt;
+        if (!applyChanges(entry->changes)) {
+            throw runtime_error("the tasks touched by the " + entry->label + " have changed since");
+        }
+        string label = entry->label;
+        undoHistory.redone();
+        return label;
     }
 
     /**
-     * Display and handle main menu options
+     * Display and handle main menu options; returns once the user exits or a
+     * termination signal arrives
      */
     void showMenu() {
-        while (true) {
-            cout << "\n=== Task Manager ===\n";
-            cout << "1. List Tasks\n";
-            cout << "2. Add Task\n";
-            cout << "3. Mark Task as Done\n";
-            cout << "4. Delete Task\n";
-            cout << "5. Show Completed Tasks\n";
-            cout << "6. Show Activity History\n";
-            cout << "0. Exit\n";
-
-            string choice;
-            cout << "\nEnter your choice (0-6): ";
-            getline(cin, choice);
-
-            if (choice == "1") listTasks();
-            else if (choice == "2") addTask();
-            else if (choice == "3") markDone();
-            else if (choice == "4") deleteTask();
-            else if (choice == "5") showCompleted();
-            else if (choice == "6") showActivityHistory();
-            else if (choice == "0") {
-                exitProgram();
-                break;
+        try {
+            while (true) {
+                printNotices();
+                cout << "\n=== Task Manager ===\n";
+                cout << "1. List Tasks\n";
+                cout << "2. Add Task\n";
+                cout << "3. Mark Task as Done\n";
+                cout << "4. Delete Task\n";
+                cout << "5. Show Completed Tasks\n";
+                cout << "6. Show Activity History\n";
+                cout << "7. Undo Last Change\n";
+                cout << "8. Redo\n";
+                cout << "9. Query Tasks\n";
+                cout << "10. Show Statistics\n";
+                cout << "11. Completion Trends\n";
+                cout << "0. Exit\n";
+
+                string choice;
+                cout << "\nEnter your choice (0-11): ";
+                input.read(choice);
+                applyPendingReload();
+
+                if (choice == "1") listTasks(nullptr, chooseListOrder());
+                else if (choice == "2") addTask();
+                else if (choice == "3") markDone();
+                else if (choice == "4") deleteTask();
+                else if (choice == "5") showCompleted();
+                else if (choice == "6") showActivityHistory();
+                else if (choice == "7") undoChange();
+                else if (choice == "8") redoChange();
+                else if (choice == "9") queryTasks();
+                else if (choice == "10") showStatistics();
+                else if (choice == "11") showTrends();
+                else if (choice == "0") {
+                    exitProgram();
+                    break;
+                }
+                else cout << "\nInvalid choice. Please try again.\n";
             }
-            else cout << "\nInvalid choice. Please try again.\n";
         }
+        catch (const ShutdownRequested&) {
+            // A termination signal ended the wait for input
+            exitOnSignal();
+        }
+    }
+
+    /**
+     * Ask how the active task list should be ordered
+     */
+    ListOrder chooseListOrder() {
+        cout << "\nSort by:\n";
+        cout << "1. Order added\n";
+        cout << "2. Priority, then deadline\n";
+        cout << "3. Deadline\n";
+        cout << "4. Creation time\n";
+
+        string choice;
+        cout << "Choose order (1-4, Enter for 1): ";
+        input.read(choice);
+        if (choice == "2") return ListOrder::PriorityDeadline;
+        if (choice == "3") return ListOrder::Deadline;
+        if (choice == "4") return ListOrder::Created;
+        return ListOrder::Added;
     }
 
     /**
      * Display all active tasks
+     * With selection, a task number typed at the page prompt is stored there
+     * and true is returned, so the caller need not ask for it again
      */
-    void listTasks() {
+    bool listTasks(string* selection = nullptr, ListOrder order = ListOrder::Added) {
         cout << "\n=== ACTIVE TASKS ===\n\n";
-        if (tasks["open_tasks"].empty()) {
+        auto view = snapshot();
+        const RecordList& open_tasks = view->records("open_tasks");
+        if (open_tasks.empty()) {
             cout << "No active tasks.\n";
-            return;
+            return false;
+        }
+
+        // Sorted lists keep the task numbers of the order added
+        TaskDate current_day = today();
+        vector<uint32_t> rows;
+        if (order != ListOrder::Added) rows = sortedRows(open_tasks, order, executor);
+        pageRows(open_tasks.size(), [&](size_t k) {
+            size_t row = rows.empty() ? k : rows[k];
+            printOpenTask(console, row + 1, open_tasks[row], current_day);
+        }, selection);
+        return selection && !selection->empty();
+    }
+
+    /**
+     * Show rows [0, total) a page at a time from a cursor; render(row) appends
+     * one row to the console buffer, so a page costs LIST_PAGE_SIZE rows however
+     * long the list is and reaches the terminal (prompt included) in one write.
+     * Returns true once the user pages past the last row. With selection, a
+     * row number typed at the prompt ends paging and is stored there.
+     */
+    template <typename RenderRow>
+    bool pageRows(size_t total, RenderRow render, string* selection = nullptr) {
+        ConsoleBuffer::Untied untied;
+        size_t cursor = 0;
+        while (true) {
+            size_t end = min(total, cursor + LIST_PAGE_SIZE);
+            for (size_t row = cursor; row < end; ++row) render(row);
+            if (total <= LIST_PAGE_SIZE) {
+                console.flush();
+                return true;
+            }
+
+            string command;
+            console << "\nRows " << cursor + 1 << "-" << end << " of " << total
+                    << " - [n]ext, [p]rev, [g]o to row, [q]uit" << (selection ? ", or a task number: " : ": ");
+            console.flush();
+            if (!input.read(command) || command == "q" || command == "Q") return false;
+            if (selection && !command.empty() && command.find_first_not_of("0123456789") == string::npos) {
+                *selection = command;
+                return false;
+            }
+            console << "\n";
+
+            if (command.empty() || command == "n" || command == "N") {
+                if (end == total) {
+                    console.flush();
+                    return true;
+                }
+                cursor = end;
+            }
+            else if (command == "p" || command == "P") {
+                cursor = cursor > LIST_PAGE_SIZE ? cursor - LIST_PAGE_SIZE : 0;
+            }
+            else if (command[0] == 'g' || command[0] == 'G') {
+                string target = command.substr(1);
+                if (target.find_first_not_of(' ') == string::npos) {
+                    console << "Go to row: ";
+                    console.flush();
+                    input.read(target);
+                }
+                try {
+                    size_t row = stoul(target);
+                    if (row < 1 || row > total) throw out_of_range("row");
+                    cursor = row - 1;
+                }
+                catch (const exception&) {
+                    console << "Enter a row between 1 and " << total << ".\n";
+                }
+            }
+            else {
+                console << "Invalid choice.\n";
+            }
+        }
+    }
+
+    /**
+     * Append a field as `cout << value` would print it (strings quoted)
+     */
+    static void putField(ConsoleBuffer& out, const json& value) {
+        if (value.is_string()) out.quoted(value.get_ref<const string&>());
+        else out << value.dump();
+    }
+
+    static void printOpenTask(ConsoleBuffer& out, size_t number, const json& task, TaskDate current_day) {
+        out << number << ". ";
+        putField(out, task["name"]);
+        out << " - Priority: ";
+        putField(out, task["priority"]);
+        out << " - Deadline: ";
+        if (auto rule = recurrenceOf(task)) {
+            out.quoted(pendingDeadline(task)->toString());
+            out << " (repeats " << RecurrenceRule::frequencyName(rule->getFrequency()) << ")";
         }
+        else {
+            putField(out, task["deadline"]);
+        }
+        out << (isOverdue(task, current_day) ? " (overdue)\n" : "\n");
+    }
+
+    static void printCompletedTask(ConsoleBuffer& out, size_t number, const json& task) {
+        out << number << ". ";
+        putField(out, task["name"]);
+        out << " - Priority: ";
+        putField(out, task["priority"]);
+        out << " - Completed: ";
+        putField(out, task["completed_at"]);
+        out << '\n';
+    }
 
-        int i = 1;
-        for (const auto& task : tasks["open_tasks"]) {
-            cout << i++ << ". " << task["name"] << " - Priority: " 
-                 << task["priority"] << " - Deadline: " << task["deadline"] << "\n";
+    static void printHistoryEntry(ConsoleBuffer& out, size_t number, const json& entry) {
+        string_view timestamp = entry["timestamp"].get_ref<const string&>();
+
+        // Remove seconds from timestamp
+        if (timestamp.length() > 16) {
+            timestamp = timestamp.substr(0, 16);
         }
+
+        out << number << ". " << timestamp << " - ";
+        putField(out, entry["program"]);
+        out << ' ';
+        putField(out, entry["language"]);
+        out << '\n';
     }
 
     /**
@@ -236,7 +3292,7 @@ public:
         
         string name;
         cout << "Enter task name: ";
-        getline(cin, name);
+        input.read(name);
         if (name.empty()) {
             cout << "Task name cannot be empty!\n";
             return;
@@ -249,7 +3305,7 @@ public:
         
         string priority_choice;
         cout << "Choose priority (1-3): ";
-        getline(cin, priority_choice);
+        input.read(priority_choice);
 
         string priority = "medium";
         if (priority_choice == "1") priority = "high";
@@ -258,25 +3314,32 @@ public:
         string deadline;
         while (true) {
             cout << "Enter deadline (DD-MM-YYYY): ";
-            getline(cin, deadline);
+            input.read(deadline);
             if (validateDate(deadline)) break;
             cout << "Invalid date format or past date! Please use DD-MM-YYYY\n";
         }
 
+        cout << "\nRepeat:\n";
+        cout << "1. No\n";
+        cout << "2. Daily\n";
+        cout << "3. Weekly\n";
+        cout << "4. Monthly\n";
+
+        string repeat_choice;
+        cout << "Choose repeat (1-4): ";
+        input.read(repeat_choice);
+
+        optional<RecurrenceRule::Frequency> repeat;
+        if (repeat_choice == "2") repeat = RecurrenceRule::Frequency::Daily;
+        else if (repeat_choice == "3") repeat = RecurrenceRule::Frequency::Weekly;
+        else if (repeat_choice == "4") repeat = RecurrenceRule::Frequency::Monthly;
+
         try {
-            json new_task = {
-                {"name", name},
-                {"priority", priority},
-                {"deadline", deadline},
-                {"created_at", getCurrentTimestamp()}
-            };
-
-            tasks["open_tasks"].push_back(new_task);
-            saveTasks(tasks);
+            addTaskRecord(name, priority, deadline, repeat);
             cout << "\nTask added successfully!\n";
         }
         catch (const exception& e) {
-            cout << "Error adding task: " << e.what() << endl;
+            cout << "Error adding task: " << e.what() << "\n";
         }
     }
 
@@ -284,30 +3347,24 @@ public:
      * Mark a task as completed and move it to completed tasks
      */
     void markDone() {
-        if (tasks["open_tasks"].empty()) {
+        if (openTaskCount() == 0) {
             cout << "\nNo tasks to mark as done!\n";
             return;
         }
 
         cout << "\n=== Mark Task as Done ===\n";
-        listTasks();
-
         string choice;
-        cout << "\nEnter task number to mark as done: ";
-        getline(cin, choice);
+        if (!listTasks(&choice)) {
+            cout << "\nEnter task number to mark as done: ";
+            input.read(choice);
+        }
 
         try {
             int idx = stoi(choice) - 1;
-            if (idx >= 0 && idx < tasks["open_tasks"].size()) {
-                json completed_task = tasks["open_tasks"][idx];
-                completed_task["completed_at"] = getCurrentTimestamp();
-                completed_task["status"] = "completed";
-
-                tasks["open_tasks"].erase(tasks["open_tasks"].begin() + idx);
-                tasks["completed_tasks"].push_back(completed_task);
-                saveTasks(tasks);
-
-                cout << "\nTask '" << completed_task["name"] << "' marked as done!\n";
+            optional<json> completed_task;
+            if (idx >= 0) completed_task = completeTask(idx);
+            if (completed_task) {
+                cout << "\nTask '" << (*completed_task)["name"] << "' marked as done!\n";
             }
             else {
                 cout << "\nInvalid task number!\n";
@@ -322,25 +3379,24 @@ public:
      * Delete a task from active tasks
      */
     void deleteTask() {
-        if (tasks["open_tasks"].empty()) {
+        if (openTaskCount() == 0) {
             cout << "\nNo tasks to delete!\n";
             return;
         }
 
         cout << "\n=== Delete Task ===\n";
-        listTasks();
-
         string choice;
-        cout << "\nEnter task number to delete: ";
-        getline(cin, choice);
+        if (!listTasks(&choice)) {
+            cout << "\nEnter task number to delete: ";
+            input.read(choice);
+        }
 
         try {
             int idx = stoi(choice) - 1;
-            if (idx >= 0 && idx < tasks["open_tasks"].size()) {
-                string task_name = tasks["open_tasks"][idx]["name"];
-                tasks["open_tasks"].erase(tasks["open_tasks"].begin() + idx);
-                saveTasks(tasks);
-                cout << "\nTask '" << task_name << "' deleted!\n";
+            optional<string> task_name;
+            if (idx >= 0) task_name = removeTask(idx);
+            if (task_name) {
+                cout << "\nTask '" << *task_name << "' deleted!\n";
             }
             else {
                 cout << "\nInvalid task number!\n";
@@ -351,22 +3407,91 @@ public:
         }
     }
 
+    /**
+     * Undo the last add, completion or deletion
+     */
+    void undoChange() {
+        try {
+            optional<string> label = undoLast();
+            if (label) cout << "\nUndid " << *label << ".\n";
+            else cout << "\nNothing to undo!\n";
+        }
+        catch (const exception& e) {
+            cout << "\nCannot undo: " << e.what() << "\n";
+        }
+    }
+
+    /**
+     * Redo the last undone change
+     */
+    void redoChange() {
+        try {
+            optional<string> label = redoLast();
+            if (label) cout << "\nRedid " << *label << ".\n";
+            else cout << "\nNothing to redo!\n";
+        }
+        catch (const exception& e) {
+            cout << "\nCannot redo: " << e.what() << "\n";
+        }
+    }
+
     /**
      * Display all completed tasks
      */
     void showCompleted() {
         cout << "\n=== COMPLETED TASKS ===\n\n";
-        if (tasks["completed_tasks"].empty()) {
+        auto view = snapshot();
+        const RecordList& completed_tasks = view->records("completed_tasks");
+        if (completed_tasks.empty() && completedArchive.segmentCount() == 0) {
             cout << "No completed tasks.\n";
             return;
         }
 
-        int i = 1;
-        for (auto it = tasks["completed_tasks"].rbegin(); 
-             it != tasks["completed_tasks"].rend(); ++it) {
-            cout << i++ << ". " << (*it)["name"] 
-                 << " - Priority: " << (*it)["priority"]
-                 << " - Completed: " << (*it)["completed_at"] << "\n";
+        // Newest first; archived blocks continue the numbering
+        size_t total = completed_tasks.size();
+        bool pastEnd = pageRows(total, [&](size_t row) {
+            printCompletedTask(console, row + 1, completed_tasks[total - 1 - row]);
+        });
+        if (!pastEnd) return;
+
+        size_t i = total + 1;
+        auto printPage = [this, &i](const json& tasks) {
+            for (auto it = tasks.rbegin(); 
+                 it != tasks.rend(); ++it) {
+                printCompletedTask(console, i++, *it);
+            }
+            console.flush();
+        };
+        pageArchive(completedArchive, "Show older completed tasks? (y/n): ", printPage);
+    }
+
+    /**
+     * Offer archived blocks newest first, one page per confirmation; only the
+     * blocks actually shown are decompressed (and checksum-verified)
+     */
+    template <typename PrintPage>
+    void pageArchive(const SegmentArchive& archive, const string& prompt, PrintPage printPage) {
+        size_t segments = archive.segmentCount();
+        optional<SegmentArchive::Segment> segment;
+        size_t blocks = 0;
+        while (segments > 0 || blocks > 0) {
+            string more;
+            cout << "\n" << prompt;
+            input.read(more);
+            if (more != "y" && more != "Y") break;
+
+            try {
+                if (blocks == 0) {
+                    segment.emplace(archive.open(--segments));
+                    blocks = segment->blockCount();
+                    if (blocks == 0) continue;
+                }
+                printPage(segment->block(--blocks));
+            }
+            catch (const exception& e) {
+                // A damaged block or segment only costs that page
+                cout << "Skipping damaged archive data: " << e.what() << "\n";
+            }
         }
     }
 
@@ -375,47 +3500,205 @@ public:
      */
     void showActivityHistory() {
         cout << "\n=== ACTIVITY HISTORY ===\n\n";
-        if (tasks["activity_history"].empty()) {
+        auto view = snapshot();
+        const RecordList& activity_history = view->records("activity_history");
+        if (activity_history.empty() && historyArchive.segmentCount() == 0) {
             cout << "No activity history.\n";
             return;
         }
 
-        int i = 1;
-        for (auto it = tasks["activity_history"].rbegin(); 
-             it != tasks["activity_history"].rend(); ++it) {
-            string timestamp = (*it)["timestamp"];
-            
-            // Remove seconds from timestamp
-            if (timestamp.length() > 16) {
-                timestamp = timestamp.substr(0, 16);
+        size_t i = 1;
+        auto printPage = [this, &i](const auto& entries) {
+            for (size_t row = entries.size(); row-- > 0; ) {
+                printHistoryEntry(console, i++, entries[row]);
+            }
+            console.flush();
+        };
+        printPage(activity_history);
+        pageArchive(historyArchive, "Show older history? (y/n): ", printPage);
+    }
+
+    /**
+     * Display the dashboard; answered from the counters, not the task lists
+     */
+    void showStatistics() {
+        cout << "\n=== STATISTICS ===\n\n";
+        TaskStats counters = statistics();
+        TaskDate current_day = today();
+
+        cout << "Open tasks: " << counters.openCount() << " (";
+        for (size_t i = TaskStats::PRIORITIES.size(); i-- > 1; ) {
+            cout << TaskStats::PRIORITIES[i] << " " << counters.openWithPriority(i) << (i > 1 ? ", " : "");
+        }
+        if (counters.openWithPriority(0) > 0) cout << ", other " << counters.openWithPriority(0);
+        cout << ")\n";
+        cout << "Overdue: " << counters.openDueBefore(current_day) << "\n";
+        cout << "Due in the next 7 days: " << counters.openDueBetween(current_day, current_day + 7) << "\n";
+        cout << "Completed: " << counters.completedCount()
+             << " (this week: " << counters.completedInWeekOf(current_day) << ")\n";
+
+        if (counters.timedCount() > 0) {
+            int64_t seconds = counters.averageSecondsToComplete();
+            cout << "Average time to complete: " << seconds / 86400 << "d " << seconds % 86400 / 3600 << "h "
+                 << seconds % 3600 / 60 << "m (over " << counters.timedCount() << " tasks)\n";
+            cout << "Time to complete:";
+            for (size_t i = 0; i < TaskStats::BUCKET_NAMES.size(); ++i) {
+                cout << (i ? " | " : " ") << TaskStats::BUCKET_NAMES[i] << ": " << counters.completedWithin(i);
+            }
+            cout << "\n";
+        }
+
+        TaskExecutor::Stats pool = executor.stats();
+        cout << "Worker pool: " << pool.threads << " threads, " << pool.queued << " queued, "
+             << pool.executed << " tasks run, " << pool.steals << " steals\n";
+    }
+
+    /**
+     * Completions per day, week or month; each bar is one range lookup in the
+     * per-day rollup, so no completed record is read
+     */
+    void showTrends() {
+        cout << "\n=== COMPLETION TRENDS ===\n\n";
+        cout << "1. Daily (last 30 days)\n";
+        cout << "2. Weekly (last 26 weeks)\n";
+        cout << "3. Monthly (last 12 months)\n";
+
+        string choice;
+        cout << "\nChoose period (1-3): ";
+        input.read(choice);
+        if (choice != "1" && choice != "2" && choice != "3") {
+            cout << "\nInvalid choice.\n";
+            return;
+        }
+
+        TaskStats counters = statistics();
+        const DailyRollup& completions = counters.completions();
+        TaskDate current_day = today();
+
+        // Ranges [from, to) oldest first, labelled by their first day
+        vector<pair<string, int64_t>> rows;
+        if (choice == "1") {
+            for (int32_t back = 29; back >= 0; --back) {
+                TaskDate day = current_day + -back;
+                rows.emplace_back(day.toString(), completions.on(day));
+            }
+        }
+        else if (choice == "2") {
+            TaskDate monday = TaskStats::weekOf(current_day);
+            for (int32_t back = 25; back >= 0; --back) {
+                TaskDate from = monday + -7 * back;
+                rows.emplace_back(from.toString(), completions.between(from, from + 7));
             }
+        }
+        else {
+            TaskDate::Civil now = current_day.civil();
+            int64_t month = static_cast<int64_t>(now.year) * 12 + (now.month - 1);
+            for (int64_t m = month - 11; m <= month; ++m) {
+                TaskDate from = TaskDate::fromCivil(static_cast<int>(m / 12), static_cast<unsigned>(m % 12) + 1, 1);
+                TaskDate to = TaskDate::fromCivil(static_cast<int>((m + 1) / 12), static_cast<unsigned>((m + 1) % 12) + 1, 1);
+                rows.emplace_back(from.toString().substr(3), completions.between(from, to));
+            }
+        }
+
+        int64_t peak = 1;
+        for (const auto& row : rows) peak = max(peak, row.second);
+        cout << "\n";
+        for (const auto& [label, count] : rows) {
+            cout << label << string(11 - label.size(), ' ') << "| "
+                 << string(static_cast<size_t>(count * 40 / peak), '#') << " " << count << "\n";
+        }
+    }
+
+    /**
+     * Index of one section of a snapshot, reused until that section changes
+     */
+    const task_query::TaskIndex& queryIndex(const TaskSnapshot& view, const string& section) {
+        const RecordList& records = view.records(section);
+        auto& cached = queryIndexes[section];
+        if (!cached.second || !cached.first.sameAs(records)) {
+            task_query::TaskIndex::DeadlineOf deadline = [](const json&) { return optional<TaskDate>(); };
+            if (section == "open_tasks") deadline = pendingDeadline;
+            else if (section == "completed_tasks") deadline = deadlineOf;
+            cached = {records, make_shared<const task_query::TaskIndex>(records, deadline, executor)};
+        }
+        return *cached.second;
+    }
+
+    /**
+     * Run a query such as "list where priority=high and deadline<2026-12-01
+     * order by deadline limit 20" over the live (not archived) records
+     */
+    void queryTasks() {
+        cout << "\n=== QUERY TASKS ===\n\n";
+        cout << "Syntax: list [open|completed|history] [where <field> <op> <value> [and ...]]\n"
+             << "        [order by <field> [asc|desc]] [limit <n>]\n"
+             << "Operators: = != < <= > >= ~ (word starts with)\n\n";
+
+        string text;
+        cout << "Query: ";
+        input.read(text);
+        if (text.empty()) return;
+
+        try {
+            task_query::Query query = task_query::parse(text);
+            string section = query.source == "completed" ? "completed_tasks"
+                           : query.source == "history" ? "activity_history" : "open_tasks";
+            auto view = snapshot();
+            const RecordList& records = view->records(section);
+
+            auto start = chrono::steady_clock::now();
+            task_query::Result result = task_query::execute(query, records, queryIndex(*view, section), executor);
+            char elapsed[32];
+            snprintf(elapsed, sizeof(elapsed), "%.2f", chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
 
-            cout << i++ << ". " << timestamp 
-                 << " - " << (*it)["program"]
-                 << " " << (*it)["language"] << "\n";
+            cout << "\n" << result.rows.size() << " of " << records.size() << " record(s); plan: "
+                 << result.plan << " (" << result.candidates << " candidate(s), "
+                 << elapsed << " ms)\n\n";
+            if (result.rows.empty()) cout << "No matching records.\n";
+
+            // Numbers match the ones shown by the matching list view
+            TaskDate current_day = today();
+            pageRows(result.rows.size(), [&](size_t k) {
+                uint32_t row = result.rows[k];
+                if (section == "open_tasks") printOpenTask(console, row + 1, records[row], current_day);
+                else if (section == "completed_tasks") printCompletedTask(console, records.size() - row, records[row]);
+                else printHistoryEntry(console, records.size() - row, records[row]);
+            });
+        }
+        catch (const invalid_argument& e) {
+            cout << "Invalid query: " << e.what() << "\n";
         }
     }
 };
 
 /**
- * Signal handler for Ctrl+C
+ * Signal handler for Ctrl+C; only wakes the menu thread waiting for input
  */
 void signalHandler(int signum) {
-    if (globalTaskManager) {
-        cout << "\nReceived interrupt signal. Cleaning up...\n";
-        globalTaskManager->exitProgram();
-    }
-    exit(signum);
+    shutdownSignal.notify(signum);
 }
 
-int main() {
+// Benchmarks include this file for TaskManager and define TASK_MANAGER_NO_MAIN
+#ifndef TASK_MANAGER_NO_MAIN
+int main(int argc, char* argv[]) {
     try {
         signal(SIGINT, signalHandler);
-        TaskManager app;
+        signal(SIGTERM, signalHandler);
+        bool sharded_layout = false;
+        bool patch_log = false;
+        size_t threads = 0;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--sharded") sharded_layout = true;
+            else if (arg == "--patch-log") patch_log = true;
+            else if (arg == "--threads" && i + 1 < argc) threads = stoul(argv[++i]);
+        }
+        TaskManager app(sharded_layout, threads, patch_log);
         app.showMenu();
     }
     catch (const exception& e) {
         cout << "\nAn unexpected error occurred: " << e.what() << endl;
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,454 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.hpp"
+#include "record_list.hpp"
+#include "task_date.hpp"
+#include "parallel_sort.hpp"
+
+/**
+ * Task Query
+ * Parser and planner for the query language of the Query menu:
+ *   list [open|completed|history] [where <field> <op> <value> [and ...]]
+ *        [order by <field> [asc|desc]] [limit <n>]
+ * Operators are = != < <= > >= and ~ (some word of the field starts with the
+ * value). A TaskIndex, built once per section version, holds the deadline and
+ * priority columns plus sorted deadline, priority and word indexes. The planner
+ * takes candidates from the most selective indexed condition (or all rows) and
+ * narrows them with tight per-column loops over a selection vector; ordering
+ * by deadline or priority sorts packed integer keys.
+ */
+namespace task_query {
+
+enum class Op { Eq, Ne, Lt, Le, Gt, Ge, Match };
+
+struct Condition {
+    std::string field;
+    Op op = Op::Eq;
+    std::string value;
+};
+
+struct Query {
+    std::string source = "open";
+    std::vector<Condition> where;
+    std::string orderBy;
+    bool descending = false;
+    size_t limit = std::numeric_limits<size_t>::max();
+};
+
+struct Result {
+    std::vector<uint32_t> rows;  // positions in the section, in output order
+    std::string plan;
+    size_t candidates = 0;
+};
+
+namespace detail {
+
+constexpr int32_t NO_DATE = std::numeric_limits<int32_t>::min();
+
+inline std::string lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+/**
+ * Lowercase alphanumeric words of a text
+ */
+inline std::vector<std::string> words(std::string_view text) {
+    std::vector<std::string> out;
+    std::string word;
+    for (char c : text) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            word.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+        }
+        else if (!word.empty()) {
+            out.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) out.push_back(std::move(word));
+    return out;
+}
+
+inline uint8_t priorityRank(std::string_view priority) {
+    std::string value = lower(priority);
+    if (value == "low") return 1;
+    if (value == "medium") return 2;
+    if (value == "high") return 3;
+    return 0;
+}
+
+/**
+ * Accept "YYYY-MM-DD" or the task format "DD-MM-YYYY"
+ */
+inline TaskDate parseDate(const std::string& text) {
+    TaskDate date;
+    if (TaskDate::parseIso(text, date) && text.size() == 10) return date;
+    if (TaskDate::parse(text, date)) return date;
+    throw std::invalid_argument("'" + text + "' is not a date (use YYYY-MM-DD)");
+}
+
+template <typename T>
+bool compare(const T& left, Op op, const T& right) {
+    switch (op) {
+        case Op::Eq: return left == right;
+        case Op::Ne: return !(left == right);
+        case Op::Lt: return left < right;
+        case Op::Le: return !(right < left);
+        case Op::Gt: return right < left;
+        case Op::Ge: return !(left < right);
+        default: return false;
+    }
+}
+
+/**
+ * True if every word of needle starts some word of text
+ */
+inline bool matchesWords(std::string_view text, std::string_view needle) {
+    std::vector<std::string> have = words(text);
+    for (const auto& want : words(needle)) {
+        bool found = std::any_of(have.begin(), have.end(), [&](const std::string& word) {
+            return word.compare(0, want.size(), want) == 0;
+        });
+        if (!found) return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * Split a query into words, quoted strings and operators, then parse it
+ * Throws invalid_argument with a readable message on bad syntax
+ */
+inline Query parse(std::string_view text) {
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < text.size(); ) {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        }
+        else if (c == '"' || c == '\'') {
+            size_t end = text.find(c, i + 1);
+            if (end == std::string_view::npos) throw std::invalid_argument("unterminated quote");
+            tokens.emplace_back(text.substr(i, end - i + 1));
+            i = end + 1;
+        }
+        else if (std::string_view("=!<>~").find(c) != std::string_view::npos) {
+            size_t length = (i + 1 < text.size() && text[i + 1] == '=' && c != '=' && c != '~') ? 2 : 1;
+            tokens.emplace_back(text.substr(i, length));
+            i += length;
+        }
+        else {
+            size_t end = i;
+            while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])) &&
+                   std::string_view("=!<>~\"'").find(text[end]) == std::string_view::npos) {
+                end++;
+            }
+            tokens.emplace_back(text.substr(i, end - i));
+            i = end;
+        }
+    }
+
+    size_t pos = 0;
+    auto peek = [&]() { return pos < tokens.size() ? detail::lower(tokens[pos]) : std::string(); };
+    auto expect = [&](const char* what) {
+        if (pos >= tokens.size()) throw std::invalid_argument(std::string("expected ") + what + " at end of query");
+        return tokens[pos++];
+    };
+    auto unquote = [](std::string value) {
+        if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'')) value = value.substr(1, value.size() - 2);
+        return value;
+    };
+
+    Query query;
+    if (peek() == "list") pos++;
+    if (peek() == "open" || peek() == "completed" || peek() == "history") query.source = detail::lower(tokens[pos++]);
+
+    if (peek() == "where") {
+        pos++;
+        do {
+            Condition condition;
+            condition.field = detail::lower(expect("a field"));
+            std::string op = expect("an operator");
+            if (op == "=") condition.op = Op::Eq;
+            else if (op == "!=") condition.op = Op::Ne;
+            else if (op == "<") condition.op = Op::Lt;
+            else if (op == "<=") condition.op = Op::Le;
+            else if (op == ">") condition.op = Op::Gt;
+            else if (op == ">=") condition.op = Op::Ge;
+            else if (op == "~") condition.op = Op::Match;
+            else throw std::invalid_argument("unknown operator '" + op + "'");
+            condition.value = unquote(expect("a value"));
+            query.where.push_back(std::move(condition));
+        } while (peek() == "and" && ++pos);
+    }
+
+    if (peek() == "order") {
+        pos++;
+        if (detail::lower(expect("'by'")) != "by") throw std::invalid_argument("expected 'by' after 'order'");
+        query.orderBy = detail::lower(expect("a field"));
+        if (peek() == "asc" || peek() == "desc") query.descending = detail::lower(tokens[pos++]) == "desc";
+    }
+
+    if (peek() == "limit") {
+        pos++;
+        std::string count = expect("a number");
+        size_t limit = 0;
+        auto [end, error] = std::from_chars(count.data(), count.data() + count.size(), limit);
+        if (count.empty() || end != count.data() + count.size()) {
+            throw std::invalid_argument("limit must be a number");
+        }
+        if (error == std::errc::result_out_of_range) throw std::invalid_argument("limit too large");
+        query.limit = limit;
+    }
+
+    if (pos < tokens.size()) throw std::invalid_argument("unexpected '" + tokens[pos] + "'");
+    return query;
+}
+
+/**
+ * Columns and indexes of one section version; immutable once built
+ */
+struct TaskIndex {
+    using DeadlineOf = std::function<std::optional<TaskDate>(const nlohmann::json&)>;
+
+    std::vector<int32_t> deadline;                           // day number or NO_DATE
+    std::vector<uint8_t> priority;                           // 0 unknown, 1 low .. 3 high
+    std::vector<std::pair<int32_t, uint32_t>> byDeadline;    // sorted (day, row)
+    std::array<std::vector<uint32_t>, 4> byPriority;         // rows per rank
+    std::vector<std::pair<std::string, uint32_t>> byWord;    // sorted (name word, row)
+
+    /**
+     * Columns and name words are extracted in parallel chunks; the indexes
+     * are then assembled and sorted on the executor
+     */
+    TaskIndex(const RecordList& records, const DeadlineOf& deadlineOf, TaskExecutor& executor) {
+        size_t n = records.size();
+        deadline.resize(n, detail::NO_DATE);
+        priority.resize(n, 0);
+        std::mutex wordsMutex;
+        executor.parallelFor(n, [&](size_t begin, size_t end) {
+            std::vector<std::pair<std::string, uint32_t>> words;
+            auto record = records.iteratorAt(begin);
+            for (size_t row = begin; row < end; ++row, ++record) {
+                if (auto day = deadlineOf(*record)) deadline[row] = day->dayNumber();
+                auto it = record->find("priority");
+                if (it != record->end() && it->is_string()) priority[row] = detail::priorityRank(it->get_ref<const std::string&>());
+
+                it = record->find("name");
+                if (it != record->end() && it->is_string()) {
+                    for (auto& word : detail::words(it->get_ref<const std::string&>())) words.emplace_back(std::move(word), row);
+                }
+            }
+            std::lock_guard<std::mutex> lock(wordsMutex);
+            byWord.insert(byWord.end(), std::make_move_iterator(words.begin()), std::make_move_iterator(words.end()));
+        });
+
+        for (uint32_t row = 0; row < n; ++row) {
+            if (deadline[row] != detail::NO_DATE) byDeadline.emplace_back(deadline[row], row);
+            byPriority[priority[row]].push_back(row);
+        }
+        parallel_sort::sort(byDeadline, executor);
+        parallel_sort::sort(byWord, executor);
+    }
+};
+
+namespace detail {
+
+/**
+ * Rows of the deadline index within a compared range, as [first, last)
+ */
+inline std::pair<size_t, size_t> deadlineRange(const TaskIndex& index, Op op, int32_t day) {
+    auto begin = index.byDeadline.begin();
+    auto end = index.byDeadline.end();
+    auto lower = std::lower_bound(begin, end, std::make_pair(day, uint32_t(0))) - begin;
+    auto upper = std::lower_bound(begin, end, std::make_pair(day + 1, uint32_t(0))) - begin;
+    size_t size = index.byDeadline.size();
+    switch (op) {
+        case Op::Eq: return {lower, upper};
+        case Op::Lt: return {0, lower};
+        case Op::Le: return {0, upper};
+        case Op::Gt: return {upper, size};
+        case Op::Ge: return {lower, size};
+        default: return {0, size};
+    }
+}
+
+inline bool recordMatches(const nlohmann::json& record, const Condition& condition) {
+    auto it = record.find(condition.field);
+    if (it == record.end()) return condition.op == Op::Ne;
+    if (it->is_number()) {
+        try {
+            return compare(it->get<double>(), condition.op, std::stod(condition.value));
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+    std::string value = it->is_string() ? it->get<std::string>() : it->dump();
+    if (condition.op == Op::Match) return matchesWords(value, condition.value);
+    if (condition.op == Op::Eq || condition.op == Op::Ne) {
+        return compare(lower(value), condition.op, lower(condition.value));
+    }
+    // Timestamps compared against a bare date look at the date part only
+    if (condition.value.size() == 10 && value.size() > 10 && value[10] == 'T') value.resize(10);
+    return compare(value, condition.op, condition.value);
+}
+
+} // namespace detail
+
+/**
+ * Plan and run a query over one section. Throws invalid_argument for bad values.
+ */
+inline Result execute(const Query& query, const RecordList& records, const TaskIndex& index, TaskExecutor& executor) {
+    using namespace detail;
+    Result result;
+    const size_t n = records.size();
+
+    // Pick the indexed condition with the fewest candidate rows
+    int best = -1;
+    size_t bestCount = n;
+    std::vector<int32_t> days(query.where.size(), NO_DATE);
+    for (size_t i = 0; i < query.where.size(); ++i) {
+        const Condition& condition = query.where[i];
+        size_t count = n;
+        if (condition.field == "deadline" && condition.op != Op::Match) {
+            days[i] = parseDate(condition.value).dayNumber();
+            if (condition.op != Op::Ne) {
+                auto [first, last] = deadlineRange(index, condition.op, days[i]);
+                count = last - first;
+            }
+        }
+        else if (condition.field == "priority" && condition.op == Op::Eq) {
+            count = index.byPriority[priorityRank(condition.value)].size();
+        }
+        else if (condition.field == "name" && condition.op == Op::Match) {
+            std::vector<std::string> want = words(condition.value);
+            if (!want.empty()) {
+                auto first = std::lower_bound(index.byWord.begin(), index.byWord.end(), std::make_pair(want[0], uint32_t(0)));
+                auto last = first;
+                while (last != index.byWord.end() && last->first.compare(0, want[0].size(), want[0]) == 0) ++last;
+                count = static_cast<size_t>(last - first);
+            }
+        }
+        if (count < bestCount) {
+            best = static_cast<int>(i);
+            bestCount = count;
+        }
+    }
+
+    // Selection vector: candidate rows in ascending order
+    std::vector<uint32_t> selection;
+    if (best >= 0) {
+        const Condition& condition = query.where[best];
+        if (condition.field == "deadline") {
+            auto [first, last] = deadlineRange(index, condition.op, days[best]);
+            for (size_t k = first; k < last; ++k) selection.push_back(index.byDeadline[k].second);
+            result.plan = "deadline index";
+        }
+        else if (condition.field == "priority") {
+            selection = index.byPriority[priorityRank(condition.value)];
+            result.plan = "priority index";
+        }
+        else {
+            std::string want = words(condition.value)[0];
+            auto it = std::lower_bound(index.byWord.begin(), index.byWord.end(), std::make_pair(want, uint32_t(0)));
+            for (; it != index.byWord.end() && it->first.compare(0, want.size(), want) == 0; ++it) selection.push_back(it->second);
+            result.plan = "text index";
+        }
+        std::sort(selection.begin(), selection.end());
+        selection.erase(std::unique(selection.begin(), selection.end()), selection.end());
+    }
+    else {
+        selection.resize(n);
+        for (uint32_t row = 0; row < n; ++row) selection[row] = row;
+        result.plan = "column scan";
+    }
+    result.candidates = selection.size();
+
+    // Narrow the selection one condition at a time
+    for (size_t i = 0; i < query.where.size(); ++i) {
+        const Condition& condition = query.where[i];
+        auto keep = selection.begin();
+        if (condition.field == "deadline" && condition.op != Op::Match) {
+            for (uint32_t row : selection) {
+                if (index.deadline[row] != NO_DATE && compare(index.deadline[row], condition.op, days[i])) *keep++ = row;
+            }
+        }
+        else if (condition.field == "priority" && condition.op != Op::Match) {
+            uint8_t rank = priorityRank(condition.value);
+            if (rank == 0) throw std::invalid_argument("priority must be high, medium or low");
+            for (uint32_t row : selection) {
+                if (compare(index.priority[row], condition.op, rank)) *keep++ = row;
+            }
+        }
+        else {
+            for (uint32_t row : selection) {
+                if (recordMatches(records[row], condition)) *keep++ = row;
+            }
+        }
+        selection.erase(keep, selection.end());
+    }
+
+    // Order: deadline and priority sort packed keys (column value above the
+    // row), other fields compare the field values
+    if (query.orderBy == "deadline" || query.orderBy == "priority") {
+        std::vector<uint64_t> keys(selection.size());
+        for (size_t k = 0; k < selection.size(); ++k) {
+            uint32_t row = selection[k];
+            uint32_t value;
+            if (query.orderBy == "priority") {
+                value = query.descending ? 3u - index.priority[row] : index.priority[row];
+            }
+            else if (index.deadline[row] == NO_DATE) {
+                value = UINT32_MAX;  // rows without a deadline sort last either way
+            }
+            else {
+                uint32_t day = static_cast<uint32_t>(index.deadline[row]) ^ 0x80000000u;
+                value = query.descending ? UINT32_MAX - 1 - day : day;
+            }
+            keys[k] = static_cast<uint64_t>(value) << 32 | row;
+        }
+        if (query.limit < keys.size()) {
+            std::nth_element(keys.begin(), keys.begin() + query.limit, keys.end());
+            keys.resize(query.limit);
+        }
+        parallel_sort::sort(keys, executor);
+        for (size_t k = 0; k < keys.size(); ++k) selection[k] = static_cast<uint32_t>(keys[k]);
+        selection.resize(keys.size());
+    }
+    else if (!query.orderBy.empty()) {
+        static const nlohmann::json missing;
+        auto before = [&](uint32_t a, uint32_t b) {
+            const nlohmann::json& x = records[a].contains(query.orderBy) ? records[a][query.orderBy] : missing;
+            const nlohmann::json& y = records[b].contains(query.orderBy) ? records[b][query.orderBy] : missing;
+            return query.descending ? y < x : x < y;
+        };
+        if (query.limit < selection.size()) {
+            std::partial_sort(selection.begin(), selection.begin() + query.limit, selection.end(),
+                              [&](uint32_t a, uint32_t b) { return before(a, b) || (!before(b, a) && a < b); });
+        }
+        else {
+            std::stable_sort(selection.begin(), selection.end(), before);
+        }
+    }
+    if (selection.size() > query.limit) selection.resize(query.limit);
+    result.rows = std::move(selection);
+    return result;
+}
+
+} // namespace task_query
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include "task_date.hpp"
+
+/**
+ * Timestamp Service
+ * Formats the shared "YYYY-MM-DDTHH:MM:SS" local timestamps without calling
+ * localtime/strftime per request. The local UTC offset is looked up with the
+ * thread-safe localtime_r once per OFFSET_WINDOW seconds (zone changes happen on
+ * quarter-hour boundaries), and each thread caches the last formatted second.
+ */
+class TimestampService {
+public:
+    static constexpr size_t LENGTH = 19;
+
+private:
+    static constexpr std::time_t OFFSET_WINDOW = 900;
+
+    // Packed {window index (high 32 bits), utc offset + 2^31 (low 32 bits)}
+    static std::atomic<uint64_t>& offsetCache() {
+        static std::atomic<uint64_t> cache{~0ull};
+        return cache;
+    }
+
+    static int32_t lookupOffset(std::time_t time) {
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        int64_t days = TaskDate::fromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday).dayNumber();
+        int64_t localSeconds = days * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+        return static_cast<int32_t>(localSeconds - static_cast<int64_t>(time));
+    }
+
+    static void put2(char* p, unsigned value) {
+        p[0] = static_cast<char>('0' + value / 10);
+        p[1] = static_cast<char>('0' + value % 10);
+    }
+
+public:
+    /**
+     * Seconds to add to a UTC time_t to get local wall-clock time
+     */
+    static int32_t utcOffset(std::time_t time) {
+        uint64_t window = static_cast<uint64_t>(time / OFFSET_WINDOW) & 0xffffffffu;
+        uint64_t cached = offsetCache().load(std::memory_order_relaxed);
+        if ((cached >> 32) == window) {
+            return static_cast<int32_t>(static_cast<int64_t>(cached & 0xffffffffu) - (1ll << 31));
+        }
+        int32_t offset = lookupOffset(time);
+        uint64_t packed = (window << 32) | static_cast<uint64_t>(static_cast<int64_t>(offset) + (1ll << 31));
+        offsetCache().store(packed, std::memory_order_relaxed);
+        return offset;
+    }
+
+    /**
+     * Write the local timestamp of a time_t into LENGTH bytes (no terminator)
+     */
+    static void format(std::time_t time, char* out) {
+        int64_t local = static_cast<int64_t>(time) + utcOffset(time);
+        int64_t days = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+        unsigned secondOfDay = static_cast<unsigned>(local - days * 86400);
+        TaskDate::Civil date = TaskDate::fromDayNumber(static_cast<int32_t>(days)).civil();
+
+        put2(out, static_cast<unsigned>(date.year) / 100);
+        put2(out + 2, static_cast<unsigned>(date.year) % 100);
+        out[4] = '-';
+        put2(out + 5, date.month);
+        out[7] = '-';
+        put2(out + 8, date.day);
+        out[10] = 'T';
+        put2(out + 11, secondOfDay / 3600);
+        out[13] = ':';
+        put2(out + 14, secondOfDay / 60 % 60);
+        out[16] = ':';
+        put2(out + 17, secondOfDay % 60);
+    }
+
+    /**
+     * Current local timestamp; reformatted at most once per second per thread
+     */
+    static std::string now() {
+        thread_local std::time_t cachedSecond = -1;
+        thread_local char cachedText[LENGTH];
+
+        std::time_t second = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        if (second != cachedSecond) {
+            format(second, cachedText);
+            cachedSecond = second;
+        }
+        return std::string(cachedText, LENGTH);
+    }
+
+    /**
+     * Today's local date
+     */
+    static TaskDate today() {
+        std::time_t second = std::time(nullptr);
+        int64_t local = static_cast<int64_t>(second) + utcOffset(second);
+        int64_t days = local >= 0 ? local / 86400 : (local - 86399) / 86400;
+        return TaskDate::fromDayNumber(static_cast<int32_t>(days));
+    }
+};
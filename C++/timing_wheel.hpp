@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Timing Wheel
+ * Hierarchical timing wheel (LEVELS x 64 slots) keyed by an integer tick.
+ * Timers live in intrusive doubly linked lists inside a node pool, so schedule
+ * and cancel are O(1); advancing only touches the slot that expires and, every
+ * 64^n ticks, cascades one higher-level slot down. Not thread-safe by itself.
+ */
+template <typename T, unsigned LEVELS = 4>
+class TimingWheel {
+public:
+    using Handle = uint64_t;
+    static constexpr Handle INVALID_HANDLE = 0;
+
+private:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint64_t expires = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t generation = 1;
+        uint32_t slot = NIL;  // level * SLOTS + index while scheduled
+        T payload{};
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::array<uint32_t, LEVELS * SLOTS> heads;
+    uint64_t now;
+    std::size_t active = 0;
+
+    /**
+     * Pick the lowest level whose span covers the distance to expiry
+     * Timers beyond the top span are parked at its end and re-linked on cascade;
+     * earliest is now + 1 for new timers and now while cascading into this tick
+     */
+    uint32_t slotFor(uint64_t expires, uint64_t earliest) const {
+        constexpr uint64_t span = uint64_t(1) << (SLOT_BITS * LEVELS);
+        if (expires < earliest) expires = earliest;
+        if (expires - now >= span) expires = now + span - 1;
+
+        unsigned level = 0;
+        while ((expires - now) >> (SLOT_BITS * (level + 1))) level++;
+        return level * SLOTS + static_cast<uint32_t>((expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    }
+
+    void link(uint32_t index, uint64_t earliest) {
+        Node& node = nodes[index];
+        node.slot = slotFor(node.expires, earliest);
+        node.prev = NIL;
+        node.next = heads[node.slot];
+        if (node.next != NIL) nodes[node.next].prev = index;
+        heads[node.slot] = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = nodes[index];
+        if (node.prev != NIL) nodes[node.prev].next = node.next;
+        else heads[node.slot] = node.next;
+        if (node.next != NIL) nodes[node.next].prev = node.prev;
+        node.slot = NIL;
+    }
+
+    void release(uint32_t index) {
+        Node& node = nodes[index];
+        node.generation++;
+        node.payload = T{};
+        freeNodes.push_back(index);
+        active--;
+    }
+
+    /**
+     * Detach a whole slot list and return its head
+     */
+    uint32_t takeSlot(uint32_t slot) {
+        uint32_t head = heads[slot];
+        heads[slot] = NIL;
+        return head;
+    }
+
+public:
+    explicit TimingWheel(uint64_t startTick = 0) : now(startTick) {
+        heads.fill(NIL);
+    }
+
+    uint64_t currentTick() const { return now; }
+    std::size_t size() const { return active; }
+
+    /**
+     * Schedule payload to fire at tick (past ticks fire on the next advance)
+     */
+    Handle schedule(uint64_t tick, T payload) {
+        uint32_t index;
+        if (!freeNodes.empty()) {
+            index = freeNodes.back();
+            freeNodes.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        Node& node = nodes[index];
+        node.expires = tick;
+        node.payload = std::move(payload);
+        link(index, now + 1);
+        active++;
+        return (static_cast<Handle>(node.generation) << 32) | index;
+    }
+
+    /**
+     * Cancel a pending timer; returns false if it already fired or was cancelled
+     */
+    bool cancel(Handle handle) {
+        uint32_t index = static_cast<uint32_t>(handle);
+        if (handle == INVALID_HANDLE || index >= nodes.size()) return false;
+        Node& node = nodes[index];
+        if (node.generation != static_cast<uint32_t>(handle >> 32) || node.slot == NIL) return false;
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    /**
+     * Move time forward to tick, calling fire(payload, expires, handle) for each
+     * due timer
+     */
+    template <typename Fire>
+    void advance(uint64_t tick, Fire&& fire) {
+        while (now < tick) {
+            now++;
+
+            // Cascade higher levels whose slot boundary was just crossed
+            for (unsigned level = 1; level < LEVELS; ++level) {
+                if ((now & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+                uint32_t slot = level * SLOTS + static_cast<uint32_t>((now >> (SLOT_BITS * level)) & (SLOTS - 1));
+                for (uint32_t index = takeSlot(slot); index != NIL; ) {
+                    uint32_t next = nodes[index].next;
+                    link(index, now);
+                    index = next;
+                }
+            }
+
+            for (uint32_t index = takeSlot(now & (SLOTS - 1)); index != NIL; ) {
+                uint32_t next = nodes[index].next;
+                nodes[index].slot = NIL;
+                if (nodes[index].expires > now) {
+                    link(index, now + 1);
+                }
+                else {
+                    T payload = std::move(nodes[index].payload);
+                    uint64_t expires = nodes[index].expires;
+                    Handle handle = (static_cast<Handle>(nodes[index].generation) << 32) | index;
+                    release(index);
+                    fire(payload, expires, handle);
+                }
+                index = next;
+            }
+        }
+    }
+};